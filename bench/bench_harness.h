@@ -0,0 +1,141 @@
+#pragma once
+
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Prevents the compiler from optimizing away a computed value, or from assuming memory is unchanged across calls
+template<typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct bench_options {
+    double warmupSeconds = 0.05;       // Runs discarded before measuring, to warm up caches, branch predictors and CPU frequency
+    double minSampleSeconds = 0.002;   // Each sample repeats the benchmark until it takes at least this long
+    unsigned repetitions = 25;         // Number of samples
+    bool perfCounters = false;         // Also count hardware events over all the samples, when perf_event_open is available
+};
+
+struct bench_result {
+    std::string m_name;
+    std::size_t m_elements;
+    // Nanoseconds per element
+    double m_min;
+    double m_median;
+    double m_p10;
+    double m_p90;
+    // Hardware events per element, NaN when unavailable or not collected
+    perf_counters::values m_events;
+};
+
+/**
+ * @brief Minimal benchmark harness: warm-up, then repeated samples of a callable processing a fixed number of elements.
+ *
+ * Results are reported in nanoseconds per element, as the median and the 10th/90th percentiles of the samples,
+ * which are much more stable than the mean on a shared machine.
+ */
+class bench_harness {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit bench_harness(bench_options options = bench_options()) : m_options(options) {
+        if (m_options.perfCounters) {
+            m_counters = std::make_unique<perf_counters>();
+            if (!m_counters->any_available()) {
+                std::printf("Hardware counters unavailable (%s), check kernel.perf_event_paranoid\n", m_counters->error().c_str());
+                m_counters.reset();
+            }
+        }
+    }
+
+    template<typename Func>
+    const bench_result& run(const std::string& name, std::size_t elements, Func&& func) {
+        // Warm up, and find how many runs make a sample long enough for the clock resolution
+        std::size_t runsPerSample = 1;
+        const auto warmupEnd = clock::now() + std::chrono::duration<double>(m_options.warmupSeconds);
+        do {
+            const auto start = clock::now();
+            for (std::size_t i = 0; i < runsPerSample; ++i) {
+                func();
+            }
+            if (seconds_since(start) < m_options.minSampleSeconds) {
+                runsPerSample *= 2;
+            }
+        } while (clock::now() < warmupEnd);
+
+        std::vector<double> samples;
+        samples.reserve(m_options.repetitions);
+        if (m_counters) {
+            m_counters->start();
+        }
+        for (unsigned r = 0; r < std::max(m_options.repetitions, 1u); ++r) {
+            const auto start = clock::now();
+            for (std::size_t i = 0; i < runsPerSample; ++i) {
+                func();
+            }
+            samples.push_back(seconds_since(start) * 1e9 / static_cast<double>(runsPerSample * std::max<std::size_t>(elements, 1)));
+        }
+        perf_counters::values events;
+        events.fill(std::nan(""));
+        if (m_counters) {
+            events = m_counters->stop();
+            const double processed = static_cast<double>(samples.size() * runsPerSample * std::max<std::size_t>(elements, 1));
+            for (double& count : events) {
+                count /= processed;
+            }
+        }
+        std::sort(samples.begin(), samples.end());
+        m_results.push_back({name, elements, samples.front(), percentile(samples, 0.5), percentile(samples, 0.1), percentile(samples, 0.9), events});
+        print(m_results.back());
+        return m_results.back();
+    }
+
+    const std::vector<bench_result>& results() const { return m_results; }
+
+    void print_header() const {
+        std::printf("%-64s %10s %10s %10s %10s %10s", "benchmark", "elements", "min", "p10", "median", "p90");
+        if (m_counters) {
+            // Per element, except IPC
+            std::printf(" %8s %10s %10s %10s %10s %10s", "IPC", "cycles", "br-misses", "L1d-misses", "LLC-misses", "dTLB-misses");
+        }
+        std::printf("\n");
+    }
+
+    void print(const bench_result& result) const {
+        std::printf("%-64s %10zu %10.3f %10.3f %10.3f %10.3f", result.m_name.c_str(), result.m_elements, result.m_min, result.m_p10, result.m_median, result.m_p90);
+        if (m_counters) {
+            const perf_counters::values& e = result.m_events;
+            std::printf(" %8.2f %10.3f %10.4f %10.4f %10.4f %10.4f", e[perf_counters::Instructions] / e[perf_counters::Cycles], e[perf_counters::Cycles],
+                        e[perf_counters::BranchMisses], e[perf_counters::L1dMisses], e[perf_counters::LlcMisses], e[perf_counters::DtlbMisses]);
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+
+private:
+    static double seconds_since(clock::time_point start) { return std::chrono::duration<double>(clock::now() - start).count(); }
+
+    // Linear interpolation between the closest ranks, on sorted samples
+    static double percentile(const std::vector<double>& sorted, double p) {
+        const double rank = p * static_cast<double>(sorted.size() - 1);
+        const std::size_t lower = static_cast<std::size_t>(rank);
+        const std::size_t upper = std::min(lower + 1, sorted.size() - 1);
+        return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - static_cast<double>(lower));
+    }
+
+    bench_options m_options;
+    std::unique_ptr<perf_counters> m_counters; // Only when requested and available
+    std::vector<bench_result> m_results;
+};
@@ -0,0 +1,168 @@
+// Compile-time benchmark of the template-heavy helpers
+//
+// Generates translation units instantiating make_synchronized() with 2 to 32 containers, and chains of composed views,
+// compiles each of them with the same compiler as the build, and reports the compile time and object size per translation unit,
+// also relative to a translation unit that only includes range_utils.h.
+//
+// Usage: range_utils_compile_bench [--quick] [--tus <count>] [filter] [-- <compiler flags>...], where the flags replace -O2
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Distinct instantiations per translation unit, so that the template cost dominates the noise of starting the compiler
+constexpr int VariantsPerUnit = 8;
+
+struct compile_case {
+    std::string m_name;
+    std::function<void(std::ostream&, int)> m_generateVariant; // Writes one function, with distinct types for each variant index
+};
+
+void write_prologue(std::ostream& out) {
+    out << "#include \"range_utils.h\"\n#include \"range_utils_buffered.h\"\n#include <tuple>\n#include <vector>\n\n"
+           "template<int I>\nstruct element { int m_value; };\n\n";
+}
+
+// Sum over make_synchronized() with `containers` vectors of distinct element types
+void write_synchronized(std::ostream& out, int variant, int containers) {
+    out << "long synchronized_" << variant << "(";
+    for (int i = 0; i < containers; ++i) {
+        out << (i > 0 ? ", " : "") << "const std::vector<element<" << variant * 64 + i << ">>& c" << i;
+    }
+    out << ") {\n    long sum = 0;\n    for (auto&& values : make_synchronized(";
+    for (int i = 0; i < containers; ++i) {
+        out << (i > 0 ? ", " : "") << 'c' << i;
+    }
+    out << ")) {\n        sum +=";
+    for (int i = 0; i < containers; ++i) {
+        out << (i > 0 ? " +" : "") << " std::get<" << i << ">(values).m_value";
+    }
+    out << ";\n    }\n    return sum;\n}\n\n";
+}
+
+// The adapters take containers rather than views, so views are composed through make_buffered()
+void write_chain(std::ostream& out, int variant, int depth) {
+    out << "long chain_" << variant << "(const std::vector<element<" << variant << ">>& c) {\n    long sum = 0;\n    for (auto&& e : ";
+    for (int i = 0; i < depth; ++i) {
+        out << "make_reversible(make_buffered(";
+    }
+    out << "make_reversible(c)";
+    for (int i = 0; i < depth; ++i) {
+        out << "))";
+    }
+    out << ") {\n        sum += e.m_value;\n    }\n    return sum;\n}\n\n";
+}
+
+struct measurement {
+    double m_seconds = std::numeric_limits<double>::infinity(); // Min over the repetitions, per translation unit
+    std::uintmax_t m_objectBytes = 0;                           // Per translation unit
+    bool m_failed = false;
+};
+
+measurement measure(const compile_case& c, const fs::path& directory, int units, int repetitions, const std::string& flags) {
+    measurement result;
+    std::vector<fs::path> sources;
+    for (int unit = 0; unit < units; ++unit) {
+        const fs::path source = directory / (c.m_name + '_' + std::to_string(unit) + ".cpp");
+        std::ofstream out(source);
+        write_prologue(out);
+        for (int variant = 0; variant < VariantsPerUnit; ++variant) {
+            c.m_generateVariant(out, unit * VariantsPerUnit + variant);
+        }
+        sources.push_back(source);
+    }
+
+    for (int r = 0; r < repetitions; ++r) {
+        double seconds = 0;
+        std::uintmax_t objectBytes = 0;
+        for (const fs::path& source : sources) {
+            fs::path object = source;
+            object.replace_extension(".o");
+            const std::string command = std::string(RANGE_UTILS_CXX_COMPILER) + " -std=c++17 -c " + flags + " -I\"" RANGE_UTILS_INCLUDE_DIR "\" \"" +
+                                        source.string() + "\" -o \"" + object.string() + '"';
+            const auto start = std::chrono::steady_clock::now();
+            if (std::system(command.c_str()) != 0) {
+                std::fprintf(stderr, "Failed to compile %s\n", source.string().c_str());
+                result.m_failed = true;
+                return result;
+            }
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            objectBytes += fs::file_size(object);
+        }
+        result.m_seconds = std::min(result.m_seconds, seconds / units);
+        result.m_objectBytes = objectBytes / static_cast<std::uintmax_t>(units);
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int repetitions = 3;
+    int units = 4;
+    std::string flags = "-O2";
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            repetitions = 1;
+            units = 1;
+        } else if (std::strcmp(argv[i], "--tus") == 0 && i + 1 < argc) {
+            units = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--") == 0) {
+            flags.clear();
+            while (++i < argc) {
+                flags += std::string(argv[i]) + ' ';
+            }
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    std::vector<compile_case> cases;
+    cases.push_back({"include_only", [](std::ostream&, int) {}});
+    for (int containers : {2, 4, 8, 16, 32}) {
+        cases.push_back({"synchronized_" + std::to_string(containers), [containers](std::ostream& out, int variant) { write_synchronized(out, variant, containers); }});
+    }
+    for (int depth : {1, 4, 8}) {
+        cases.push_back({"buffered_chain_" + std::to_string(depth), [depth](std::ostream& out, int variant) { write_chain(out, variant, depth); }});
+    }
+
+    const fs::path directory = fs::temp_directory_path() / "range_utils_compile_bench";
+    fs::create_directories(directory);
+
+    std::printf("%s %s, %d translation units per case, %d instantiations per unit, min of %d runs\n\n", RANGE_UTILS_CXX_COMPILER, flags.c_str(), units,
+                VariantsPerUnit, repetitions);
+    std::printf("%-24s %12s %12s %14s\n", "case", "ms per TU", "ms over base", "object bytes");
+    double baseline = 0;
+    int failures = 0;
+    for (const compile_case& c : cases) {
+        if (c.m_name != "include_only" && c.m_name.find(filter) == std::string::npos) {
+            continue;
+        }
+        const measurement m = measure(c, directory, units, repetitions, flags);
+        if (m.m_failed) {
+            ++failures;
+            continue;
+        }
+        if (c.m_name == "include_only") {
+            baseline = m.m_seconds;
+        }
+        std::printf("%-24s %12.1f %12.1f %14ju\n", c.m_name.c_str(), m.m_seconds * 1e3, (m.m_seconds - baseline) * 1e3, m.m_objectBytes);
+        std::fflush(stdout);
+    }
+    fs::remove_all(directory);
+    return failures > 0 ? 1 : 0;
+}
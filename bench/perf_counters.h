@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Hardware performance counters of the calling thread, read with perf_event_open on Linux.
+ *
+ * Each event is opened on its own, so that the events the CPU (or a VM) doesn't support are reported as unavailable
+ * instead of disabling the others. When the kernel multiplexes more events than the PMU has counters, the values are
+ * scaled by the fraction of time each event was actually counted. On other platforms, or when perf_event_open is denied
+ * (eg. kernel.perf_event_paranoid > 2, or a container without CAP_PERFMON), all the events are unavailable.
+ */
+class perf_counters {
+public:
+    enum event : std::size_t { Cycles, Instructions, BranchMisses, L1dMisses, LlcMisses, DtlbMisses, EventCount };
+    using values = std::array<double, EventCount>; // NaN for the unavailable events
+
+    perf_counters() {
+        m_fds.fill(-1);
+#ifdef __linux__
+        const std::uint64_t readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const std::pair<std::uint32_t, std::uint64_t> configs[EventCount] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | readMiss},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | readMiss},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | readMiss},
+        };
+        for (std::size_t i = 0; i < EventCount; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = configs[i].first;
+            attr.config = configs[i].second;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            m_fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (m_fds[i] < 0 && m_error.empty()) {
+                m_error = std::strerror(errno);
+            }
+        }
+#else
+        m_error = "perf_event_open is only available on Linux";
+#endif
+    }
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+    ~perf_counters() {
+#ifdef __linux__
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    bool available(event e) const { return m_fds[e] >= 0; }
+    bool any_available() const {
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+    // Reason why the first unavailable event couldn't be opened, or empty if all of them are available
+    const std::string& error() const { return m_error; }
+
+    void start() {
+#ifdef __linux__
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    // Counts since start()
+    values stop() {
+        values result;
+        result.fill(std::nan(""));
+#ifdef __linux__
+        for (std::size_t i = 0; i < EventCount; ++i) {
+            if (m_fds[i] >= 0) {
+                ioctl(m_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        for (std::size_t i = 0; i < EventCount; ++i) {
+            std::uint64_t data[3]; // value, time enabled, time running
+            if (m_fds[i] >= 0 && read(m_fds[i], data, sizeof(data)) == static_cast<ssize_t>(sizeof(data)) && data[2] > 0) {
+                result[i] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+            }
+        }
+#endif
+        return result;
+    }
+
+private:
+    std::array<int, EventCount> m_fds;
+    std::string m_error;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Stand-ins for the Qt containers, so that the benchmarks build without Qt while exercising the same code paths
+// in the helpers: implicitly shared storage that detaches on non-const access, plain pointers as QVector iterators,
+// int sizes, and QMap iterators that dereference to the value with the key available through key().
+
+template<typename T>
+class qt_vector {
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    qt_vector() : m_data(std::make_shared<std::vector<T>>()) {}
+    explicit qt_vector(int size, const T& value = T()) : m_data(std::make_shared<std::vector<T>>(static_cast<std::size_t>(size), value)) {}
+
+    int size() const { return static_cast<int>(m_data->size()); }
+    const T& operator[](int i) const { return (*m_data)[static_cast<std::size_t>(i)]; }
+    T& operator[](int i) { detach(); return (*m_data)[static_cast<std::size_t>(i)]; }
+
+    const_iterator begin() const { return m_data->data(); }
+    const_iterator end() const { return m_data->data() + m_data->size(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crbegin() const { return rbegin(); }
+    const_reverse_iterator crend() const { return rend(); }
+
+    iterator begin() { detach(); return m_data->data(); }
+    iterator end() { detach(); return m_data->data() + m_data->size(); }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+
+private:
+    void detach() {
+        if (m_data.use_count() > 1) {
+            m_data = std::make_shared<std::vector<T>>(*m_data);
+        }
+    }
+
+    std::shared_ptr<std::vector<T>> m_data;
+};
+
+template<typename K, typename V>
+class qt_map {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = V;
+
+    struct const_iterator {
+        const K& key() const { return m_it->first; }
+        const V& value() const { return m_it->second; }
+        const V& operator*() const { return m_it->second; }
+        const_iterator& operator++() { ++m_it; return *this; }
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) { return lhs.m_it == rhs.m_it; }
+        friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) { return lhs.m_it != rhs.m_it; }
+
+        typename std::map<K, V>::const_iterator m_it;
+    };
+
+    struct const_key_value_iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<const K&, const V&>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        value_type operator*() const { return {m_it->first, m_it->second}; }
+        const_key_value_iterator& operator++() { ++m_it; return *this; }
+        const_key_value_iterator operator++(int) { const_key_value_iterator previous = *this; ++m_it; return previous; }
+        friend bool operator==(const const_key_value_iterator& lhs, const const_key_value_iterator& rhs) { return lhs.m_it == rhs.m_it; }
+        friend bool operator!=(const const_key_value_iterator& lhs, const const_key_value_iterator& rhs) { return lhs.m_it != rhs.m_it; }
+
+        typename std::map<K, V>::const_iterator m_it;
+    };
+
+    int size() const { return static_cast<int>(m_data->size()); }
+    void insert(const K& key, const V& value) { detach(); (*m_data)[key] = value; }
+    void clear() { m_data = std::make_shared<std::map<K, V>>(); }
+
+    const_iterator begin() const { return {m_data->cbegin()}; }
+    const_iterator end() const { return {m_data->cend()}; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    const_key_value_iterator keyValueBegin() const { return {m_data->cbegin()}; }
+    const_key_value_iterator keyValueEnd() const { return {m_data->cend()}; }
+
+private:
+    void detach() {
+        if (m_data.use_count() > 1) {
+            m_data = std::make_shared<std::map<K, V>>(*m_data);
+        }
+    }
+
+    std::shared_ptr<std::map<K, V>> m_data = std::make_shared<std::map<K, V>>();
+};
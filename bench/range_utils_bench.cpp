@@ -0,0 +1,199 @@
+// Micro-benchmarks comparing the range_utils helpers against the equivalent hand-written loops
+//
+// Each benchmark runs on working sets sized for the L1, L2 and L3 caches and for main memory,
+// and reports nanoseconds per element. Usage: range_utils_bench [--quick] [--perf] [filter]
+//
+// --perf adds hardware counters per element (IPC, branch, cache and TLB misses), on Linux when perf_event_open is allowed.
+
+#include "bench_harness.h"
+#include "qt_like_containers.h"
+
+#include "range_utils.h"
+
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct cache_level {
+    const char* m_name;
+    std::size_t m_bytes; // Total size of the containers in the benchmark
+};
+
+// Typical sizes that fit each level on current desktop and server CPUs, with DRAM well beyond any L3
+const cache_level CacheLevels[] = {
+    {"L1", 16 << 10},
+    {"L2", 256 << 10},
+    {"L3", 4 << 20},
+    {"DRAM", 128 << 20},
+};
+
+struct bench_suite {
+    bench_harness m_harness;
+    std::string m_filter;
+
+    template<typename Raw, typename Helper>
+    void compare(const std::string& name, const cache_level& level, std::size_t elements, Raw&& raw, Helper&& helper) {
+        if (name.find(m_filter) == std::string::npos) {
+            return;
+        }
+        const std::string suffix = std::string(" @") + level.m_name;
+        m_harness.run(name + " raw" + suffix, elements, raw);
+        m_harness.run(name + " helper" + suffix, elements, helper);
+    }
+};
+
+// Read through a volatile, so that the compiler can't specialize the loop for a known direction
+bool opaque(bool value) {
+    volatile bool copy = value;
+    return copy;
+}
+
+void bench_reversible(bench_suite& suite, const cache_level& level) {
+    const std::size_t count = level.m_bytes / sizeof(int);
+    std::vector<int> values(count);
+    std::iota(values.begin(), values.end(), 0);
+
+    suite.compare("make_reversible std::vector<int> backward", level, count,
+                  [&] {
+                      std::uint32_t sum = 0;
+                      for (auto it = values.crbegin(); it != values.crend(); ++it) {
+                          sum += static_cast<std::uint32_t>(*it);
+                      }
+                      do_not_optimize(sum);
+                  },
+                  [&] {
+                      std::uint32_t sum = 0;
+                      for (int value : make_reversible(values)) {
+                          sum += static_cast<std::uint32_t>(value);
+                      }
+                      do_not_optimize(sum);
+                  });
+
+    const bool backward = opaque(false);
+    suite.compare("make_reversible std::vector<int> runtime forward", level, count,
+                  [&] {
+                      std::uint32_t sum = 0;
+                      for (auto it = values.cbegin(); it != values.cend(); ++it) {
+                          sum += static_cast<std::uint32_t>(*it);
+                      }
+                      do_not_optimize(sum);
+                  },
+                  [&] {
+                      std::uint32_t sum = 0;
+                      for (int value : make_reversible(values, backward)) {
+                          sum += static_cast<std::uint32_t>(value);
+                      }
+                      do_not_optimize(sum);
+                  });
+
+    const qt_vector<int> qtValues(static_cast<int>(count), 1);
+    suite.compare("make_reversible qt_vector<int> backward", level, count,
+                  [&] {
+                      std::uint32_t sum = 0;
+                      for (auto it = qtValues.crbegin(); it != qtValues.crend(); ++it) {
+                          sum += static_cast<std::uint32_t>(*it);
+                      }
+                      do_not_optimize(sum);
+                  },
+                  [&] {
+                      std::uint32_t sum = 0;
+                      for (int value : make_reversible(qtValues)) {
+                          sum += static_cast<std::uint32_t>(value);
+                      }
+                      do_not_optimize(sum);
+                  });
+}
+
+void bench_synchronized(bench_suite& suite, const cache_level& level) {
+    const std::size_t count = level.m_bytes / (3 * sizeof(float));
+    const std::vector<float> xs(count, 1.5f), ys(count, 2.f), zs(count, 0.25f);
+    suite.compare("make_synchronized 3x std::vector<float>", level, count,
+                  [&] {
+                      float sum = 0;
+                      for (std::size_t i = 0; i < count; ++i) {
+                          sum += xs[i] * ys[i] + zs[i];
+                      }
+                      do_not_optimize(sum);
+                  },
+                  [&] {
+                      float sum = 0;
+                      for (auto&& [x, y, z] : make_synchronized(xs, ys, zs)) {
+                          sum += x * y + z;
+                      }
+                      do_not_optimize(sum);
+                  });
+
+    const std::size_t mixedCount = level.m_bytes / (sizeof(int) + sizeof(double));
+    const std::vector<int> ids(mixedCount, 3);
+    const qt_vector<double> weights(static_cast<int>(mixedCount), 0.5);
+    suite.compare("make_synchronized std::vector<int>+qt_vector<double>", level, mixedCount,
+                  [&] {
+                      double sum = 0;
+                      for (std::size_t i = 0; i < mixedCount; ++i) {
+                          sum += ids[i] * weights[static_cast<int>(i)];
+                      }
+                      do_not_optimize(sum);
+                  },
+                  [&] {
+                      double sum = 0;
+                      for (auto&& [id, weight] : make_synchronized(ids, weights)) {
+                          sum += id * weight;
+                      }
+                      do_not_optimize(sum);
+                  });
+}
+
+void bench_keyval(bench_suite& suite, const cache_level& level) {
+    // Approximate size of a std::map<int, int> node with the allocator overhead
+    const std::size_t count = level.m_bytes / 48;
+    qt_map<int, int> map;
+    for (std::size_t i = 0; i < count; ++i) {
+        map.insert(static_cast<int>(i * 7919 % count), static_cast<int>(i));
+    }
+    suite.compare("make_keyval qt_map<int, int>", level, count,
+                  [&] {
+                      std::uint32_t sum = 0;
+                      for (auto it = map.cbegin(); it != map.cend(); ++it) {
+                          sum += static_cast<std::uint32_t>(it.key() + it.value());
+                      }
+                      do_not_optimize(sum);
+                  },
+                  [&] {
+                      std::uint32_t sum = 0;
+                      for (auto [key, value] : make_keyval(map)) {
+                          sum += static_cast<std::uint32_t>(key + value);
+                      }
+                      do_not_optimize(sum);
+                  });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench_options options;
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            options.warmupSeconds = 0.01;
+            options.repetitions = 5;
+        } else if (std::strcmp(argv[i], "--perf") == 0) {
+            options.perfCounters = true;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    bench_suite suite{bench_harness(options), filter};
+    std::printf("Nanoseconds per element, over %u samples\n\n", options.repetitions);
+    suite.m_harness.print_header();
+    for (const cache_level& level : CacheLevels) {
+        bench_reversible(suite, level);
+        bench_synchronized(suite, level);
+        bench_keyval(suite, level);
+    }
+    return 0;
+}
@@ -1,9 +1,234 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#if __has_include(<version>)
+#include <version>
+#endif
+#ifdef __cpp_lib_ranges
+#include <ranges>
+#endif
+
+// Split protocol, used to parallelize any range adapter (see parallel_for_each() in range_utils_parallel.h)
+//
+// A splittable view provides:
+//   - std::size_t size_hint() const: the (approximate) number of elements in the view
+//   - split() const: a std::pair of two views covering the first and second halves of the view, in iteration order
+// The halves themselves must be splittable too, so that they can be recursively split down to a grain size.
+// Each split must make progress: both halves must be smaller than the view. A view that can't be split any further,
+// like a single line of text, returns itself and an empty view, and is then processed as a single piece.
+// Halves may refer to data owned by the view they were split from, so they must not outlive it.
+// All the adapters in this file implement it by splitting their begin()/end() iterators into range_slice halves.
+
+// Uses operator+= for random-access iterators, and falls back to linear stepping otherwise
+template<typename It>
+auto advance_iterator(It& it, std::ptrdiff_t n, int) -> decltype(it += n, void()) { it += n; }
+template<typename It>
+void advance_iterator(It& it, std::ptrdiff_t n, long) { while (n-- > 0) ++it; }
+
+template<typename It>
+struct range_slice {
+    It begin() const { return m_begin; }
+    It end() const { return m_end; }
+    std::size_t size_hint() const { return m_size; }
+
+    std::pair<range_slice, range_slice> split() const {
+        It mid = m_begin;
+        advance_iterator(mid, static_cast<std::ptrdiff_t>(m_size / 2), 0);
+        return {range_slice{m_begin, mid, m_size / 2}, range_slice{mid, m_end, m_size - m_size / 2}};
+    }
+
+    It m_begin;
+    It m_end;
+    std::size_t m_size;
+};
+
+template<typename It>
+range_slice<It> make_range_slice(It first, It last, std::size_t size) { return range_slice<It>{first, last, size}; }
+
+// Iterator category of It, or input if It has no iterator traits, like some single-pass iterators
+template<typename It, typename = void>
+struct iterator_category_or_input {
+    using type = std::input_iterator_tag;
+};
+template<typename It>
+struct iterator_category_or_input<It, std::conditional_t<true, void, typename std::iterator_traits<It>::iterator_category>> {
+    using type = typename std::iterator_traits<It>::iterator_category;
+};
+
+// Whether C has a size(), and whether all of Cs do, ie. whether the element count of a synchronized range is known before iterating
+template<typename C, typename = void>
+struct has_size : std::false_type {};
+template<typename C>
+struct has_size<C, std::conditional_t<true, void, decltype(std::declval<const C&>().size())>> : std::true_type {};
+template<typename...Cs>
+using all_have_size = std::is_same<std::integer_sequence<bool, true, has_size<Cs>::value...>, std::integer_sequence<bool, has_size<Cs>::value..., true>>;
+
+// Whether View implements the split protocol. The adapters only declare split() when they can implement it,
+// rather than failing in its body, so that this is false for views that can't be split, like zipped generators
+template<typename View, typename = void>
+struct has_split : std::false_type {};
+template<typename View>
+struct has_split<View, std::conditional_t<true, void, decltype(std::declval<const View&>().size_hint(), std::declval<const View&>().split())>> : std::true_type {};
+
+// Instrumentation mode, enabled by defining RANGE_UTILS_INSTRUMENTATION before including this header
+//
+// The adapters then count the operations of their iterators in per-thread range_counters, to measure the overhead
+// of a (composed) view, eg. how many comparisons per element it really does. Use a range_counters_scope around a loop
+// to report them. When disabled, RANGE_UTILS_COUNT() expands to nothing and the iterators are not wrapped.
+#ifdef RANGE_UTILS_INSTRUMENTATION
+#include <cstdint>
+#include <cstdio>
+
+struct range_counters {
+    std::uint64_t m_dereferences = 0;
+    std::uint64_t m_increments = 0;
+    std::uint64_t m_comparisons = 0;
+    std::uint64_t m_elementCopies = 0;       // Elements returned by value by operator*
+    std::uint64_t m_containerReferences = 0; // Lvalue containers referenced by an adapter
+    std::uint64_t m_containerMoves = 0;      // Temporary containers moved into an adapter
+    // Containers are never copied: the storage of the adapters has deleted copy operations (see range_storage)
+
+    friend range_counters operator-(const range_counters& lhs, const range_counters& rhs) {
+        return {lhs.m_dereferences - rhs.m_dereferences, lhs.m_increments - rhs.m_increments, lhs.m_comparisons - rhs.m_comparisons,
+                lhs.m_elementCopies - rhs.m_elementCopies, lhs.m_containerReferences - rhs.m_containerReferences, lhs.m_containerMoves - rhs.m_containerMoves};
+    }
+
+    static range_counters& thread_counters() {
+        static thread_local range_counters counters;
+        return counters;
+    }
+};
+
+#define RANGE_UTILS_COUNT(counter, n) (range_counters::thread_counters().counter += (n))
+
+/**
+ * @brief Iterator wrapper counting the operations on iterators that the adapters return as is, like keyValueBegin().
+ */
+template<typename It>
+struct counting_iterator {
+    using iterator_category = typename std::iterator_traits<It>::iterator_category;
+    using value_type = typename std::iterator_traits<It>::value_type;
+    using difference_type = typename std::iterator_traits<It>::difference_type;
+    using pointer = typename std::iterator_traits<It>::pointer;
+    using reference = typename std::iterator_traits<It>::reference;
+
+    reference operator*() const { RANGE_UTILS_COUNT(m_dereferences, 1); return *m_it; }
+    counting_iterator& operator++() { RANGE_UTILS_COUNT(m_increments, 1); ++m_it; return *this; }
+    counting_iterator operator++(int) { counting_iterator copy = *this; ++*this; return copy; }
+    template<typename N, typename = decltype(std::declval<It&>() += std::declval<N>())>
+    counting_iterator& operator+=(N n) { m_it += n; return *this; }
+    friend bool operator==(const counting_iterator& lhs, const counting_iterator& rhs) { RANGE_UTILS_COUNT(m_comparisons, 1); return lhs.m_it == rhs.m_it; }
+    friend bool operator!=(const counting_iterator& lhs, const counting_iterator& rhs) { RANGE_UTILS_COUNT(m_comparisons, 1); return lhs.m_it != rhs.m_it; }
+
+    It m_it;
+};
+
+template<typename It>
+counting_iterator<It> instrument_iterator(It it) { return {it}; }
+
+/**
+ * @brief RAII scope reporting the counters of the current thread accumulated during its lifetime, in total and per element.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * #define RANGE_UTILS_INSTRUMENTATION
+ * #include "range_utils.h"
+ *
+ * {
+ *     range_counters_scope scope("zip", values.size());
+ *     for (auto&& [value, label] : make_synchronized(values, labels)) {
+ *         ...
+ *     }
+ * } // prints to stderr: zip: 1000 elements, 1000 dereferences (1.00/element), ..., 3 comparisons/element, 2 containers referenced, 0 moved
+ * @endcode
+ */
+class range_counters_scope {
+public:
+    explicit range_counters_scope(const char* label, std::size_t elements = 0) : m_label(label), m_elements(elements), m_start(range_counters::thread_counters()) {}
+    range_counters_scope(const range_counters_scope&) = delete;
+    range_counters_scope& operator=(const range_counters_scope&) = delete;
+    ~range_counters_scope() {
+        const range_counters c = counters();
+        const double elements = static_cast<double>(m_elements > 0 ? m_elements : 1);
+        std::fprintf(stderr, "%s: %zu elements, %llu dereferences (%.2f/element), %llu increments (%.2f/element), %llu comparisons (%.2f/element), "
+                             "%llu element copies (%.2f/element), %llu containers referenced, %llu moved\n",
+                     m_label, m_elements, static_cast<unsigned long long>(c.m_dereferences), c.m_dereferences / elements,
+                     static_cast<unsigned long long>(c.m_increments), c.m_increments / elements,
+                     static_cast<unsigned long long>(c.m_comparisons), c.m_comparisons / elements,
+                     static_cast<unsigned long long>(c.m_elementCopies), c.m_elementCopies / elements,
+                     static_cast<unsigned long long>(c.m_containerReferences), static_cast<unsigned long long>(c.m_containerMoves));
+    }
+
+    // Counters accumulated since the construction of the scope
+    range_counters counters() const { return range_counters::thread_counters() - m_start; }
+
+private:
+    const char* m_label;
+    std::size_t m_elements;
+    range_counters m_start;
+};
+#else
+#define RANGE_UTILS_COUNT(counter, n) ((void)0)
+
+template<typename It>
+It instrument_iterator(It it) { return it; }
+#endif
+
+// Call-site timing, enabled by defining RANGE_UTILS_TIMING before including this header (see range_utils_timing.h)
+//
+// The begin() of the adapters takes RANGE_UTILS_CALL_SITE_PARAM and passes it on to timed_begin() with RANGE_UTILS_CALL_SITE_ARG.
+// When disabled, both macros expand to nothing, and timed_begin()/timed_end() return the iterator as is.
+#ifdef RANGE_UTILS_TIMING
+#include "range_utils_timing.h"
+
+#define RANGE_UTILS_CALL_SITE_PARAM range_call_site callSite = range_call_site::current()
+#define RANGE_UTILS_CALL_SITE_ARG , callSite
+#else
+#define RANGE_UTILS_CALL_SITE_PARAM
+#define RANGE_UTILS_CALL_SITE_ARG
+
+template<typename It>
+It timed_begin(It it) { return it; }
+template<typename It>
+It timed_end(It it) { return it; }
+#endif
+
+// Storage for the container of an adapter. Lvalues are referenced through a pointer, so that adapters over lvalues
+// are trivially copyable and cheap to pass around. Temporaries are moved into the adapter, which makes it move-only,
+// so that copying it can't silently deep-copy the container.
+template<typename C>
+class range_storage {
+public:
+    explicit range_storage(C&& container) : m_container(std::move(container)) { RANGE_UTILS_COUNT(m_containerMoves, 1); }
+    range_storage(range_storage&&) = default;
+    range_storage& operator=(range_storage&&) = default;
+    range_storage(const range_storage&) = delete;
+    range_storage& operator=(const range_storage&) = delete;
+
+    // Owned containers are only accessed as const, since modifying temporaries is generally not intended
+    const C& get() const { return m_container; }
+    const C& cget() const { return m_container; }
+
+private:
+    C m_container;
+};
+
+template<typename C>
+class range_storage<C&> {
+public:
+    explicit range_storage(C& container) : m_container(&container) { RANGE_UTILS_COUNT(m_containerReferences, 1); }
+
+    C& get() const { return *m_container; }
+    const C& cget() const { return *m_container; }
+
+private:
+    C* m_container;
+};
 
 template<typename C>
 struct reversible_range_iterator {
@@ -13,20 +238,65 @@ struct reversible_range_iterator {
 
     /**
      * @brief This is a proxy for forward/backward iterators that satisfies the requirements of range-for loops (basically just operators *,++ and !=)
+     *
+     * It also provides the operations of the category of the underlying iterators, up to random access, and the matching
+     * iterator typedefs, so that it can be used with the standard algorithms, and models the c++20 iterator concepts.
      */
     template<typename ForwardIterator, typename BackwardIterator>
     struct iterator_proxy {
-        // Default implementation, where ForwardIterator is a standard iterator with a ::reference typedef
-        template<typename _It = ForwardIterator>
-        typename _It::reference operator*() { return m_isReverse ? *m_bwdIt : *m_fwdIt; }
-        // Partial specialization for cases like QByteArray, where ForwardIterator is a plain pointer and has no ::reference or ::value_type typedefs
-        // Fallback to the ::value_type on the container itself in that case
-        template<typename _It = ForwardIterator, typename = std::enable_if_t<std::is_pointer<_It>::value>>
-        typename NoRefC::value_type operator*() { return m_isReverse ? *m_bwdIt : *m_fwdIt; }
-
-        auto& operator++() { if (m_isReverse) ++m_bwdIt; else ++m_fwdIt; return *this; }
-
-        friend bool operator!=(const iterator_proxy& lhs, const iterator_proxy& rhs) { return lhs.m_isReverse ? lhs.m_bwdIt != rhs.m_bwdIt : lhs.m_fwdIt != rhs.m_fwdIt; }
+        using difference_type = typename std::iterator_traits<ForwardIterator>::difference_type;
+        using value_type = typename std::iterator_traits<ForwardIterator>::value_type;
+        // Plain pointers, like the iterators of QByteArray, dereference to values rather than to references
+        using reference = std::conditional_t<std::is_pointer<ForwardIterator>::value, value_type, typename std::iterator_traits<ForwardIterator>::reference>;
+        using pointer = void;
+        // Iterators dereferencing to values are only legacy input iterators, while the c++20 concepts allow it for any category
+        using iterator_category = std::conditional_t<std::is_reference<reference>::value, typename std::iterator_traits<ForwardIterator>::iterator_category, std::input_iterator_tag>;
+        using iterator_concept = typename std::iterator_traits<ForwardIterator>::iterator_category;
+
+        reference operator*() const {
+            RANGE_UTILS_COUNT(m_dereferences, 1);
+            RANGE_UTILS_COUNT(m_elementCopies, std::is_reference<reference>::value ? 0 : 1);
+            return m_isReverse ? *m_bwdIt : *m_fwdIt;
+        }
+
+        auto& operator++() { RANGE_UTILS_COUNT(m_increments, 1); if (m_isReverse) ++m_bwdIt; else ++m_fwdIt; return *this; }
+        iterator_proxy operator++(int) { iterator_proxy previous = *this; ++*this; return previous; }
+
+        // Only available for bidirectional iterators
+        template<typename _It = ForwardIterator, typename = decltype(--std::declval<_It&>())>
+        iterator_proxy& operator--() { if (m_isReverse) --m_bwdIt; else --m_fwdIt; return *this; }
+        template<typename _It = ForwardIterator, typename = decltype(--std::declval<_It&>())>
+        iterator_proxy operator--(int) { iterator_proxy previous = *this; --*this; return previous; }
+
+        // Only available for random-access iterators, allows splitting the range in O(1)
+        template<typename N, typename = decltype(std::declval<ForwardIterator&>() += std::declval<N>())>
+        auto& operator+=(N n) { if (m_isReverse) m_bwdIt += n; else m_fwdIt += n; return *this; }
+        template<typename _It = ForwardIterator, typename = decltype(std::declval<_It&>() += 1)>
+        iterator_proxy& operator-=(difference_type n) { return *this += -n; }
+        template<typename _It = ForwardIterator, typename = decltype(std::declval<_It&>() += 1)>
+        friend iterator_proxy operator+(iterator_proxy it, difference_type n) { return it += n; }
+        template<typename _It = ForwardIterator, typename = decltype(std::declval<_It&>() += 1)>
+        friend iterator_proxy operator+(difference_type n, iterator_proxy it) { return it += n; }
+        template<typename _It = ForwardIterator, typename = decltype(std::declval<_It&>() += 1)>
+        friend iterator_proxy operator-(iterator_proxy it, difference_type n) { return it += -n; }
+        template<typename _It = ForwardIterator, typename = decltype(std::declval<_It&>() - std::declval<_It&>())>
+        friend difference_type operator-(const iterator_proxy& lhs, const iterator_proxy& rhs) { return lhs.m_isReverse ? lhs.m_bwdIt - rhs.m_bwdIt : lhs.m_fwdIt - rhs.m_fwdIt; }
+        template<typename _It = ForwardIterator, typename = decltype(std::declval<_It&>() += 1)>
+        reference operator[](difference_type n) const { return *(*this + n); }
+        template<typename _It = ForwardIterator, typename = decltype(std::declval<_It&>() - std::declval<_It&>())>
+        friend bool operator<(const iterator_proxy& lhs, const iterator_proxy& rhs) { return rhs - lhs > 0; }
+        template<typename _It = ForwardIterator, typename = decltype(std::declval<_It&>() - std::declval<_It&>())>
+        friend bool operator>(const iterator_proxy& lhs, const iterator_proxy& rhs) { return rhs < lhs; }
+        template<typename _It = ForwardIterator, typename = decltype(std::declval<_It&>() - std::declval<_It&>())>
+        friend bool operator<=(const iterator_proxy& lhs, const iterator_proxy& rhs) { return !(rhs < lhs); }
+        template<typename _It = ForwardIterator, typename = decltype(std::declval<_It&>() - std::declval<_It&>())>
+        friend bool operator>=(const iterator_proxy& lhs, const iterator_proxy& rhs) { return !(lhs < rhs); }
+
+        friend bool operator!=(const iterator_proxy& lhs, const iterator_proxy& rhs) {
+            RANGE_UTILS_COUNT(m_comparisons, 1);
+            return lhs.m_isReverse ? lhs.m_bwdIt != rhs.m_bwdIt : lhs.m_fwdIt != rhs.m_fwdIt;
+        }
+        friend bool operator==(const iterator_proxy& lhs, const iterator_proxy& rhs) { return !(lhs != rhs); }
 
         ForwardIterator base() { return m_isReverse ? m_bwdIt.base() : m_fwdIt; }
 
@@ -41,20 +311,45 @@ struct reversible_range_iterator {
     using rit = typename NoRefC::reverse_iterator;
 
     // Default implementation for the const_iterator case
-    auto begin() const { return iterator_proxy<cit, crit>{m_container.cbegin(), m_container.crbegin(), m_iterateBackward}; }
-    auto end() const { return iterator_proxy<cit, crit>{m_container.cend(), m_container.crend(), m_iterateBackward}; }
+    // Only the iterator of the iteration direction is set, the other one is value-initialized and never used,
+    // so that the proxies don't call both end() and rend(), which may detach a non-const Qt container.
+    // The proxies still hold both iterators, since the direction is only known at runtime, and so does their end()
+    auto begin(RANGE_UTILS_CALL_SITE_PARAM) const {
+        const NoRefC& c = m_container.cget();
+        return timed_begin(iterator_proxy<cit, crit>{m_iterateBackward ? cit{} : c.cbegin(), m_iterateBackward ? c.crbegin() : crit{}, m_iterateBackward} RANGE_UTILS_CALL_SITE_ARG);
+    }
+    auto end() const {
+        const NoRefC& c = m_container.cget();
+        return timed_end(iterator_proxy<cit, crit>{m_iterateBackward ? cit{} : c.cend(), m_iterateBackward ? c.crend() : crit{}, m_iterateBackward});
+    }
 
     // These non-const overloads only make sense with non-const lvalues, so they must be conditionally compiled
     template<typename _C = C, typename = std::enable_if_t<std::is_lvalue_reference<_C>::value && !std::is_const<NoRefC>::value>>
-    auto begin() { return iterator_proxy<it, rit>{m_container.begin(), m_container.rbegin(), m_iterateBackward}; }
+    auto begin(RANGE_UTILS_CALL_SITE_PARAM) {
+        NoRefC& c = m_container.get();
+        return timed_begin(iterator_proxy<it, rit>{m_iterateBackward ? it{} : c.begin(), m_iterateBackward ? c.rbegin() : rit{}, m_iterateBackward} RANGE_UTILS_CALL_SITE_ARG);
+    }
     template<typename _C = C, typename = std::enable_if_t<std::is_lvalue_reference<_C>::value && !std::is_const<NoRefC>::value>>
-    auto end() { return iterator_proxy<it, rit>{m_container.end(), m_container.rend(), m_iterateBackward}; }
+    auto end() {
+        NoRefC& c = m_container.get();
+        return timed_end(iterator_proxy<it, rit>{m_iterateBackward ? it{} : c.end(), m_iterateBackward ? c.rend() : rit{}, m_iterateBackward});
+    }
+
+    // Split protocol, see range_slice
+    std::size_t size_hint() const { return static_cast<std::size_t>(m_container.cget().size()); }
+#ifdef __cpp_lib_ranges
+    // O(1) size for std::ranges::size(), and the algorithms that use it, when the container provides one
+    auto size() const requires requires(const NoRefC& c) { c.size(); } { return m_container.cget().size(); }
+#endif
+    auto split() const { return make_range_slice(begin(), end(), size_hint()).split(); }
+    template<typename _C = C, typename = std::enable_if_t<std::is_lvalue_reference<_C>::value && !std::is_const<NoRefC>::value>>
+    auto split() { return make_range_slice(begin(), end(), size_hint()).split(); }
 
 private:
-    // This will expand to `[const] C&` for lvalues and `const C` for rvalues (ie. the temporary lifetime gets extended)
+    // C is `[const] C&` for lvalues, which are referenced, and `C` for rvalues, which are moved in (ie. the temporary lifetime gets extended)
     // See https://en.cppreference.com/w/cpp/language/template_argument_deduction#Deduction_from_a_function_call (list item 4)
     // and https://en.cppreference.com/w/cpp/language/reference#Forwarding_references for details about this behavior
-    const C m_container;
+    range_storage<C> m_container;
     bool m_iterateBackward;
 };
 
@@ -63,6 +358,9 @@ private:
  *
  * The extra boolean parameter allows toggling forward/backward iteration at runtime with a single for-loop body.
  *
+ * Lvalue containers are referenced, so the adapter is trivially copyable, while temporaries are moved into it,
+ * which makes it move-only (see range_storage).
+ *
  * Usage example:
  *
  * @code{.cpp}
@@ -130,6 +428,15 @@ void for_each_in_tuple(std::tuple<Ts...>& tuple, Func&& func){
     for_each_in_tuple_impl(tuple, std::forward<Func>(func), std::make_index_sequence<sizeof...(Ts)>());
 }
 
+template<typename Func, typename...Ts, std::size_t...Is>
+void for_each_in_tuple_impl(const std::tuple<Ts...>& tuple, Func&& f, std::index_sequence<Is...>){
+    (void) std::initializer_list<int>{ ((void)f(std::get<Is>(tuple)), 0)... };
+}
+template<typename Func, typename...Ts>
+void for_each_in_tuple(const std::tuple<Ts...>& tuple, Func&& func){
+    for_each_in_tuple_impl(tuple, std::forward<Func>(func), std::make_index_sequence<sizeof...(Ts)>());
+}
+
 template<typename Func, typename...Ts, std::size_t...Is>
 auto transform_tuple_impl(const std::tuple<Ts...>& tuple, Func&& f, std::index_sequence<Is...>) -> std::tuple<decltype(f(std::declval<Ts>()))...> {
     return std::make_tuple(f(std::get<Is>(tuple))...);
@@ -141,38 +448,128 @@ auto transform_tuple(const std::tuple<Ts...>& tuple, Func&& f) -> std::tuple<dec
 
 template <typename...Containers>
 struct synchronized_range_iterator {
-    synchronized_range_iterator(const Containers&... containers) : m_containers(containers...) {}
+    synchronized_range_iterator(Containers&&... containers) : m_containers(std::forward<Containers>(containers)...) {}
+
+    // When all the containers are sized, the iterators count down the elements left until the end of the shortest container,
+    // so that the end test is a single integer compare, and end() doesn't need the end() of each container: with c++17 it's
+    // an empty sentinel, and before that, range-for loops need begin() and end() of the same type, so an iterator with nothing left.
+    // Otherwise, like for generators, end() holds the end() of each container, and the end test compares each of them.
+    static constexpr bool Counted = all_have_size<std::decay_t<Containers>...>::value;
 
     /**
      * @brief This is a wrapper for forward/backward iterators that satisfies the requirements of range-for loops (basically just operators *,++ and !=)
+     *
+     * It is at most a forward iterator, since the end of the shortest container can't be reached backwards in lockstep.
+     * It dereferences to a tuple of values, which only makes a legacy input iterator, but a c++20 forward iterator.
      */
     struct const_iterator {
-        typename std::tuple<typename Containers::value_type...> operator*() const { return transform_tuple(m_iterators, [](const auto& it) { return *it; }); }
-        const_iterator& operator++() { for_each_in_tuple(m_iterators, [](auto& it) { return ++it; }); return *this; }
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::tuple<typename std::decay_t<Containers>::value_type...>;
+        using reference = value_type;
+        using pointer = void;
+        using iterator_category = std::input_iterator_tag;
+        using iterator_concept = std::conditional_t<std::is_base_of<std::forward_iterator_tag, std::common_type_t<std::random_access_iterator_tag,
+                                                        typename iterator_category_or_input<typename std::decay_t<Containers>::const_iterator>::type...>>::value,
+                                                    std::forward_iterator_tag, std::input_iterator_tag>;
+
+        value_type operator*() const {
+            RANGE_UTILS_COUNT(m_dereferences, sizeof...(Containers));
+            RANGE_UTILS_COUNT(m_elementCopies, sizeof...(Containers));
+            return transform_tuple(m_iterators, [](const auto& it) { return *it; });
+        }
+        const_iterator& operator++() {
+            RANGE_UTILS_COUNT(m_increments, sizeof...(Containers));
+            for_each_in_tuple(m_iterators, [](auto& it) { return ++it; });
+            m_remaining -= Counted ? 1 : 0;
+            return *this;
+        }
+        const_iterator operator++(int) { const_iterator previous = *this; ++*this; return previous; }
+        // Only available if all the iterators are random-access, allows splitting the range in O(1)
+        template<typename N, typename = decltype(std::make_tuple((std::declval<typename std::decay_t<Containers>::const_iterator&>() += std::declval<N>())...))>
+        const_iterator& operator+=(N n) {
+            for_each_in_tuple(m_iterators, [n](auto& it) { return it += n; });
+            m_remaining -= Counted ? static_cast<std::ptrdiff_t>(n) : 0;
+            return *this;
+        }
 
         // Implement any-of for tuple equality, instead of the default all-of implemented by std::tuple
         // This allows stopping when any iterator has reached end(), to support collections with different sizes
-        template<std::size_t Cur, std::size_t Max, typename It>
-        struct iterator_tuple_compare {
-            static constexpr bool compare(const It& lhs, const It& rhs) {
-                return std::get<Cur>(lhs) == std::get<Cur>(rhs) || iterator_tuple_compare<Cur + 1, Max, It>::compare(lhs, rhs);
+        // Expanded over an index sequence rather than recursively, which instantiates a single function for any number of containers
+        template<typename It, std::size_t...Is>
+        static bool any_equal(const It& lhs, const It& rhs, std::index_sequence<Is...>) {
+            bool equal = false;
+            (void) std::initializer_list<bool>{ (equal = equal || (RANGE_UTILS_COUNT(m_comparisons, 1), std::get<Is>(lhs) == std::get<Is>(rhs)))... };
+            return equal;
+        }
+
+        friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) { return !(lhs == rhs); }
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) {
+            if (Counted) {
+                RANGE_UTILS_COUNT(m_comparisons, 1);
+                return lhs.m_remaining == rhs.m_remaining;
             }
-        };
-        template<std::size_t Max, typename It>
-        struct iterator_tuple_compare<Max, Max, It> {
-            static constexpr bool compare(const It&, const It&) { return false; }
-        };
+            return any_equal(lhs.m_iterators, rhs.m_iterators, std::index_sequence_for<Containers...>());
+        }
 
-        friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) { return !iterator_tuple_compare<0, std::tuple_size<decltype(m_iterators)>::value, decltype(m_iterators)>::compare(lhs.m_iterators, rhs.m_iterators); }
-
-        std::tuple<typename Containers::const_iterator...> m_iterators;
+        std::tuple<typename std::decay_t<Containers>::const_iterator...> m_iterators;
+        std::ptrdiff_t m_remaining = 0; // Elements left until the end of the shortest container if Counted, 0 otherwise
     };
 
-    const_iterator begin() const { return {transform_tuple(m_containers, [](const auto& it) { return it.begin(); }) }; }
-    const_iterator end() const { return {transform_tuple(m_containers, [](const auto& it) { return it.end(); }) }; }
+#if __cpp_range_based_for >= 201603
+    /**
+     * @brief The end() of counted ranges, which is reached when the iterator has no elements left
+     */
+    struct sentinel {
+        friend bool operator==(const const_iterator& it, sentinel) { RANGE_UTILS_COUNT(m_comparisons, 1); return it.m_remaining == 0; }
+        friend bool operator==(sentinel, const const_iterator& it) { return it == sentinel(); }
+        friend bool operator!=(const const_iterator& it, sentinel) { return !(it == sentinel()); }
+        friend bool operator!=(sentinel, const const_iterator& it) { return !(it == sentinel()); }
+    };
+#endif
+
+    auto begin(RANGE_UTILS_CALL_SITE_PARAM) const {
+        return timed_begin(const_iterator{transform_tuple(m_containers, [](const auto& c) { return c.cget().begin(); }), remaining(std::integral_constant<bool, Counted>())}
+                           RANGE_UTILS_CALL_SITE_ARG);
+    }
+    auto end() const { return timed_end(end_iterator(std::integral_constant<bool, Counted>())); }
+
+    // Split protocol, see range_slice. Iteration stops at the shortest container, and so does splitting.
+    // Only declared when all the containers have a size(), which generators and other single-pass ranges don't
+    template<bool Sized = Counted, typename = std::enable_if_t<Sized>>
+    std::size_t size_hint() const {
+        std::size_t size = static_cast<std::size_t>(-1);
+        for_each_in_tuple(m_containers, [&size](const auto& c) {
+            const std::size_t containerSize = static_cast<std::size_t>(c.cget().size());
+            size = containerSize < size ? containerSize : size; // Rather than std::min(), so that <algorithm> is only included by the opt-in modes
+        });
+        return sizeof...(Containers) > 0 ? size : 0;
+    }
+#ifdef __cpp_lib_ranges
+    // O(1) size for std::ranges::size(), and the algorithms that use it, when all the containers provide one
+    std::size_t size() const requires Counted { return size_hint(); }
+#endif
+    template<bool Sized = Counted, typename = std::enable_if_t<Sized>>
+    auto split() const {
+        const std::size_t size = size_hint();
+        auto first = begin();
+        auto last = first;
+        advance_iterator(last, static_cast<std::ptrdiff_t>(size), 0); // Not end(), which may not be reachable from begin() in lockstep
+        return make_range_slice(first, last, size).split();
+    }
 
 private:
-    std::tuple<Containers...> m_containers;
+    std::ptrdiff_t remaining(std::true_type) const { return static_cast<std::ptrdiff_t>(size_hint()); }
+    std::ptrdiff_t remaining(std::false_type) const { return 0; }
+#if __cpp_range_based_for >= 201603
+    sentinel end_iterator(std::true_type) const { return {}; }
+#else
+    // The counted end() only holds value-initialized iterators, which are never compared nor dereferenced
+    const_iterator end_iterator(std::true_type) const { return const_iterator{{}, 0}; }
+#endif
+    const_iterator end_iterator(std::false_type) const { return const_iterator{transform_tuple(m_containers, [](const auto& c) { return c.cget().end(); }), 0}; }
+
+    // Lvalues are referenced and rvalues are moved in, like for reversible_range_iterator
+    std::tuple<range_storage<Containers>...> m_containers;
 };
 
 /**
@@ -182,7 +579,11 @@ private:
  * which allows extracting the values as structured bindings with c++17, and it works for any number of containers at the same time.
  *
  * If the containers do not have the same element count (ie. don't take the same number of iterations to go from begin() to end()),
- * then iteration stops when any of the iterators reaches end().
+ * then iteration stops when any of the iterators reaches end(). When all the containers have a size(), the iterators count down
+ * the elements of the shortest one instead, so that the end test is a single integer compare.
+ *
+ * Lvalue containers are referenced rather than copied, while temporaries (including move-only ranges like generator<T>)
+ * are moved into the helper, so that their lifetime extends to the end of the iteration.
  *
  * Usage example:
  *
@@ -202,21 +603,28 @@ private:
  *
  */
 template <typename...Containers>
-struct synchronized_range_iterator<Containers...> make_synchronized(const Containers&... containers) { return synchronized_range_iterator<Containers...>(containers...); }
+auto make_synchronized(Containers&&... containers) { return synchronized_range_iterator<Containers...>(std::forward<Containers>(containers)...); }
 
 
 template<typename C>
 struct key_value_range_iterator {
     key_value_range_iterator(C&& container) : m_container(std::forward<C>(container))  {}
 
-    auto begin() const { return m_container.keyValueBegin(); }
-    auto end() const { return m_container.keyValueEnd(); }
+    auto begin(RANGE_UTILS_CALL_SITE_PARAM) const { return timed_begin(instrument_iterator(m_container.get().keyValueBegin()) RANGE_UTILS_CALL_SITE_ARG); }
+    auto end() const { return timed_end(instrument_iterator(m_container.get().keyValueEnd())); }
+
+    // Split protocol, see range_slice. Splitting is linear in the container size for node-based containers like QMap and QHash
+    std::size_t size_hint() const { return static_cast<std::size_t>(m_container.cget().size()); }
+#ifdef __cpp_lib_ranges
+    auto size() const requires requires(const std::remove_reference_t<C>& c) { c.size(); } { return m_container.cget().size(); }
+#endif
+    auto split() const { return make_range_slice(begin(), end(), size_hint()).split(); }
 
 private:
-    // This will expand to `[const] C&` for lvalues and `const C` for rvalues (ie. the temporary lifetime gets extended)
+    // C is `[const] C&` for lvalues, which are referenced, and `C` for rvalues, which are moved in (ie. the temporary lifetime gets extended)
     // See https://en.cppreference.com/w/cpp/language/template_argument_deduction#Deduction_from_a_function_call (list item 4)
     // and https://en.cppreference.com/w/cpp/language/reference#Forwarding_references for details about this behavior
-    const C m_container;
+    range_storage<C> m_container;
 };
 
 /**
@@ -280,3 +688,24 @@ auto make_keyval(C& container) { return key_value_range_iterator<const C&>(conta
  */
 template<typename C>
 auto make_mutable_keyval(C& container) { return key_value_range_iterator<C&>(container); }
+
+
+#ifdef __cpp_lib_ranges
+// C++20 ranges support: the adapters are views, since they are cheap to move, and copyable when they reference lvalues.
+// The iterators of adapters over lvalues only refer to the containers, so these adapters are also borrowed ranges,
+// which range algorithms can return iterators into, even when called on a temporary adapter.
+namespace std::ranges {
+template<typename C>
+inline constexpr bool enable_view<reversible_range_iterator<C>> = true;
+template<typename C>
+inline constexpr bool enable_borrowed_range<reversible_range_iterator<C>> = is_lvalue_reference_v<C>;
+template<typename...Containers>
+inline constexpr bool enable_view<synchronized_range_iterator<Containers...>> = true;
+template<typename...Containers>
+inline constexpr bool enable_borrowed_range<synchronized_range_iterator<Containers...>> = (is_lvalue_reference_v<Containers> && ...);
+template<typename C>
+inline constexpr bool enable_view<key_value_range_iterator<C>> = true;
+template<typename C>
+inline constexpr bool enable_borrowed_range<key_value_range_iterator<C>> = is_lvalue_reference_v<C>;
+}
+#endif
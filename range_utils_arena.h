@@ -0,0 +1,167 @@
+#pragma once
+
+#include "range_utils.h"
+#include "range_utils_buffered.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Monotonic memory arena: allocations bump a pointer in large chunks, and are only freed all at once.
+ *
+ * release() and rewind() keep the chunks for the next allocations, so an arena reused across loops or requests
+ * stops calling malloc once it has grown to the peak size. An arena is not thread-safe: use one per thread,
+ * like thread_default().
+ *
+ * make_buffered() and make_partitioned() take an arena for their storage, while the other adapters still use the heap.
+ */
+class monotonic_arena {
+public:
+    static constexpr std::size_t DefaultChunkSize = 64 * 1024;
+
+    // Position in the arena, to rewind() to
+    struct marker {
+        std::size_t m_chunk;
+        std::size_t m_offset;
+    };
+
+    explicit monotonic_arena(std::size_t chunkSize = DefaultChunkSize) : m_chunkSize(chunkSize > 0 ? chunkSize : DefaultChunkSize) {}
+    monotonic_arena(const monotonic_arena&) = delete;
+    monotonic_arena& operator=(const monotonic_arena&) = delete;
+    ~monotonic_arena() {
+        for (const chunk& c : m_chunks) {
+            ::operator delete(c.m_data);
+        }
+    }
+
+    void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) {
+        for (;; ++m_current, m_offset = 0) {
+            if (m_current == m_chunks.size()) {
+                const std::size_t previousSize = m_chunks.empty() ? m_chunkSize / 2 : m_chunks.back().m_size;
+                const std::size_t chunkSize = std::max(previousSize * 2, size + alignment);
+                m_chunks.push_back({static_cast<char*>(::operator new(chunkSize)), chunkSize});
+            }
+            const chunk& c = m_chunks[m_current];
+            const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(c.m_data);
+            const std::size_t offset = static_cast<std::size_t>(((base + m_offset + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1)) - base);
+            if (offset <= c.m_size && size <= c.m_size - offset) {
+                m_offset = offset + size;
+                return c.m_data + offset;
+            }
+        }
+    }
+
+    marker mark() const { return {m_current, m_offset}; }
+    void rewind(marker position) {
+        m_current = position.m_chunk;
+        m_offset = position.m_offset;
+    }
+    void release() { rewind({0, 0}); }
+
+    // Total size of the chunks owned by the arena
+    std::size_t capacity() const {
+        std::size_t capacity = 0;
+        for (const chunk& c : m_chunks) {
+            capacity += c.m_size;
+        }
+        return capacity;
+    }
+
+    static monotonic_arena& thread_default() {
+        static thread_local monotonic_arena arena;
+        return arena;
+    }
+
+private:
+    struct chunk {
+        char* m_data;
+        std::size_t m_size;
+    };
+
+    std::size_t m_chunkSize;
+    std::vector<chunk> m_chunks;
+    std::size_t m_current = 0;
+    std::size_t m_offset = 0;
+};
+
+/**
+ * @brief RAII scope that frees everything allocated in an arena during its lifetime (but keeps the memory for reuse).
+ *
+ * Scopes can be nested. Containers using an arena_allocator on this arena must not outlive the scope.
+ */
+class arena_scope {
+public:
+    explicit arena_scope(monotonic_arena& arena = monotonic_arena::thread_default()) : m_arena(arena), m_marker(arena.mark()) {}
+    arena_scope(const arena_scope&) = delete;
+    arena_scope& operator=(const arena_scope&) = delete;
+    ~arena_scope() { m_arena.rewind(m_marker); }
+
+    monotonic_arena& arena() const { return m_arena; }
+
+private:
+    monotonic_arena& m_arena;
+    monotonic_arena::marker m_marker;
+};
+
+/**
+ * @brief Standard allocator allocating from a monotonic_arena, where deallocation is a no-op.
+ *
+ * Default-constructed allocators use the thread-local default arena of the constructing thread.
+ */
+template<typename T>
+class arena_allocator {
+public:
+    using value_type = T;
+
+    arena_allocator() noexcept : m_arena(&monotonic_arena::thread_default()) {}
+    arena_allocator(monotonic_arena& arena) noexcept : m_arena(&arena) {}
+    template<typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept : m_arena(&other.arena()) {}
+
+    T* allocate(std::size_t count) {
+        if (count > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, std::size_t) noexcept {}
+
+    monotonic_arena& arena() const { return *m_arena; }
+
+    friend bool operator==(const arena_allocator& lhs, const arena_allocator& rhs) { return lhs.m_arena == rhs.m_arena; }
+    friend bool operator!=(const arena_allocator& lhs, const arena_allocator& rhs) { return lhs.m_arena != rhs.m_arena; }
+
+private:
+    monotonic_arena* m_arena;
+};
+
+/**
+ * @brief This overload of make_buffered() takes its storage from an arena instead of the heap.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * for (const Request& request : requests) {
+ *     arena_scope scope; // everything below is freed at once at the end of each iteration
+ *     for (const Node& node : make_reversible(make_buffered(walkTree(request.root), scope.arena()))) {
+ *         ...
+ *     }
+ * }
+ * @endcode
+ */
+template<typename R>
+auto make_buffered(R&& range, monotonic_arena& arena) {
+    using T = std::decay_t<decltype(*std::begin(range))>;
+    std::vector<T, arena_allocator<T>> buffer{arena_allocator<T>(arena)};
+    for (auto&& value : range) {
+        buffer.push_back(std::forward<decltype(value)>(value));
+    }
+    return buffer;
+}
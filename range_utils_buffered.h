@@ -0,0 +1,31 @@
+#pragma once
+
+#include "range_utils.h"
+
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief This helper materializes any single-pass range into a std::vector, so that it can be iterated again or backwards.
+ *
+ * This is mostly useful for input ranges like generator<T> or make_consuming(), which can't be traversed backwards
+ * or split for parallel processing: the returned vector can be passed as a temporary to make_reversible() and the other helpers.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * for (const Node& node : make_reversible(make_buffered(walkTree(root)))) {
+ *     qDebug() << node.name; // post-order walk, in reverse
+ * }
+ * @endcode
+ */
+template<typename R>
+auto make_buffered(R&& range) {
+    std::vector<std::decay_t<decltype(*std::begin(range))>> buffer;
+    for (auto&& value : range) {
+        buffer.push_back(std::forward<decltype(value)>(value));
+    }
+    return buffer;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "range_utils.h"
+#include "range_utils_buffered.h"
+
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+#error "range_utils_generator.h requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Recycling allocator for coroutine frames, with per-thread free lists per 64 bytes size class.
+ *
+ * Generators created in a loop typically have the same frame size, so after warm-up each frame allocation
+ * is a pop from a thread-local list instead of a malloc. Frames larger than MaxPooledSize bypass the pool,
+ * and each size class keeps at most MaxCachedPerClass free frames.
+ */
+class coroutine_frame_pool {
+public:
+    static constexpr std::size_t Granularity = 64;
+    static constexpr std::size_t MaxPooledSize = 4096;
+    static constexpr std::size_t MaxCachedPerClass = 64;
+
+    static void* allocate(std::size_t size) {
+        const std::size_t sizeClass = size_class(size);
+        if (sizeClass < ClassCount && alive()) {
+            cache& c = local();
+            if (free_frame* frame = c.m_lists[sizeClass]) {
+                c.m_lists[sizeClass] = frame->m_next;
+                --c.m_counts[sizeClass];
+                return frame;
+            }
+            return ::operator new((sizeClass + 1) * Granularity);
+        }
+        return ::operator new(size);
+    }
+
+    static void deallocate(void* p, std::size_t size) noexcept {
+        const std::size_t sizeClass = size_class(size);
+        if (sizeClass < ClassCount && alive()) {
+            cache& c = local();
+            if (c.m_counts[sizeClass] < MaxCachedPerClass) {
+                c.m_lists[sizeClass] = new (p) free_frame{c.m_lists[sizeClass]};
+                ++c.m_counts[sizeClass];
+                return;
+            }
+        }
+        ::operator delete(p);
+    }
+
+private:
+    static constexpr std::size_t ClassCount = MaxPooledSize / Granularity;
+
+    struct free_frame {
+        free_frame* m_next;
+    };
+
+    struct cache {
+        ~cache() {
+            alive() = false; // Frames destroyed later in this thread's teardown go straight back to the heap
+            for (free_frame* list : m_lists) {
+                while (list) {
+                    free_frame* next = list->m_next;
+                    ::operator delete(list);
+                    list = next;
+                }
+            }
+        }
+
+        free_frame* m_lists[ClassCount] = {};
+        std::size_t m_counts[ClassCount] = {};
+    };
+
+    static std::size_t size_class(std::size_t size) { return (size + Granularity - 1) / Granularity - 1; }
+    static cache& local() { static thread_local cache c; return c; }
+    static bool& alive() { static thread_local bool isAlive = true; return isAlive; }
+};
+
+/**
+ * @brief A lazily evaluated, single-pass range of values produced by a coroutine with co_yield.
+ *
+ * Coroutine frames are allocated from the coroutine_frame_pool, so creating generators in a tight loop
+ * doesn't hit malloc once the pool is warm. Exceptions thrown by the coroutine body are rethrown
+ * from the iteration.
+ *
+ * Generators are move-only, and can be passed as temporaries to make_synchronized(), or to make_buffered()
+ * to be iterated backwards with make_reversible().
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * generator<const Node*> walk(const Node* node) {
+ *     if (!node)
+ *         co_return;
+ *     co_yield node;
+ *     for (const Node* child : node->children)
+ *         for (const Node* descendant : walk(child))
+ *             co_yield descendant;
+ * }
+ *
+ * for (auto&& [index, node] : make_synchronized(indices, walk(root))) {
+ *     qDebug() << index << node->name;
+ * }
+ * @endcode
+ */
+template<typename T>
+class generator {
+public:
+    using value_type = std::remove_cv_t<std::remove_reference_t<T>>;
+    using reference = const value_type&;
+
+    struct promise_type {
+        generator get_return_object() { return generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        // The yielded value stays alive in the coroutine frame until it is resumed, so only its address is kept
+        std::suspend_always yield_value(const value_type& value) noexcept { m_value = std::addressof(value); return {}; }
+        std::suspend_always yield_value(value_type&& value) noexcept { m_value = std::addressof(value); return {}; }
+
+        void return_void() noexcept {}
+        void unhandled_exception() { m_error = std::current_exception(); }
+
+        // Generators are synchronous, co_await isn't supported in their body
+        template<typename U>
+        std::suspend_never await_transform(U&&) = delete;
+
+        static void* operator new(std::size_t size) { return coroutine_frame_pool::allocate(size); }
+        static void operator delete(void* p, std::size_t size) noexcept { coroutine_frame_pool::deallocate(p, size); }
+
+        const value_type* m_value = nullptr;
+        std::exception_ptr m_error;
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    /**
+     * @brief This is a single-pass input iterator that resumes the coroutine on each increment
+     */
+    struct iterator {
+        using iterator_category = std::input_iterator_tag;
+        using value_type = generator::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = generator::reference;
+
+        reference operator*() const { return *m_coroutine.promise().m_value; }
+        pointer operator->() const { return m_coroutine.promise().m_value; }
+        iterator& operator++() { resume(m_coroutine); return *this; }
+        void operator++(int) { ++*this; }
+
+        // Only the end state matters, since all iterators share the coroutine position
+        friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.at_end() == rhs.at_end(); }
+        friend bool operator!=(const iterator& lhs, const iterator& rhs) { return lhs.at_end() != rhs.at_end(); }
+        bool at_end() const { return !m_coroutine || m_coroutine.done(); }
+
+        handle_type m_coroutine;
+    };
+    using const_iterator = iterator;
+
+    generator(generator&& other) noexcept : m_coroutine(std::exchange(other.m_coroutine, {})) {}
+    generator& operator=(generator&& other) noexcept { std::swap(m_coroutine, other.m_coroutine); return *this; }
+    ~generator() { if (m_coroutine) m_coroutine.destroy(); }
+
+    // begin() starts the coroutine, and can only be called once. It is const so that const adapters like
+    // make_synchronized() can drive it, but it still consumes the generator
+    iterator begin() const { if (m_coroutine) resume(m_coroutine); return {m_coroutine}; }
+    iterator end() const { return {nullptr}; }
+
+private:
+    explicit generator(handle_type coroutine) : m_coroutine(coroutine) {}
+
+    static void resume(handle_type coroutine) {
+        coroutine.resume();
+        if (coroutine.done() && coroutine.promise().m_error) {
+            std::rethrow_exception(std::exchange(coroutine.promise().m_error, nullptr));
+        }
+    }
+
+    handle_type m_coroutine;
+};
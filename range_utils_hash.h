@@ -0,0 +1,433 @@
+#pragma once
+
+#include "range_utils_arena.h"
+#include "range_utils_parallel.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Finalizer of MurmurHash3, spreads the entropy of weak hashes (like the identity std::hash<int>) over all the bits
+inline std::uint64_t mix_hash(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+template<typename K, typename Hash = std::hash<K>>
+std::uint64_t hash_key(const K& key) { return mix_hash(static_cast<std::uint64_t>(Hash()(key))); }
+
+/**
+ * @brief Open-addressing hash map with linear probing, storing the full hash of each key to make probing and rehashing cheap.
+ *
+ * Keys and values must be default-constructible. Lookups take a precomputed hash, so that a key is hashed only once
+ * when it is also used for partitioning. Iteration with make_keyval() yields std::pair<const K&, const V&>.
+ */
+template<typename K, typename V>
+class flat_hash_map {
+public:
+    struct key_value_iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<const K&, const V&>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        value_type operator*() const { return {m_map->m_keys[m_index], m_map->m_values[m_index]}; }
+        key_value_iterator& operator++() { m_index = m_map->next_used(m_index + 1); return *this; }
+        key_value_iterator operator++(int) { key_value_iterator it = *this; ++*this; return it; }
+        friend bool operator==(const key_value_iterator& lhs, const key_value_iterator& rhs) { return lhs.m_index == rhs.m_index; }
+        friend bool operator!=(const key_value_iterator& lhs, const key_value_iterator& rhs) { return lhs.m_index != rhs.m_index; }
+
+        const flat_hash_map* m_map;
+        std::size_t m_index;
+    };
+
+    explicit flat_hash_map(std::size_t capacity = 16) { rehash(capacity); }
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    /**
+     * @brief Returns the value for @p key, inserting a default-constructed one if needed, and whether it was inserted.
+     */
+    std::pair<V*, bool> try_emplace_hashed(std::uint64_t hash, const K& key) {
+        if ((m_size + 1) * 2 > m_hashes.size()) {
+            rehash(m_hashes.size() * 2);
+        }
+        hash = hash | 1; // 0 marks empty slots
+        for (std::size_t i = hash & m_mask;; i = (i + 1) & m_mask) {
+            if (m_hashes[i] == 0) {
+                m_hashes[i] = hash;
+                m_keys[i] = key;
+                ++m_size;
+                return {&m_values[i], true};
+            }
+            if (m_hashes[i] == hash && m_keys[i] == key) {
+                return {&m_values[i], false};
+            }
+        }
+    }
+
+    const V* find_hashed(std::uint64_t hash, const K& key) const {
+        hash = hash | 1;
+        for (std::size_t i = hash & m_mask;; i = (i + 1) & m_mask) {
+            if (m_hashes[i] == 0) {
+                return nullptr;
+            }
+            if (m_hashes[i] == hash && m_keys[i] == key) {
+                return &m_values[i];
+            }
+        }
+    }
+
+    const V* find(const K& key) const { return find_hashed(hash_key(key), key); }
+
+    // Calls @p func(hash, key, value) for each element, moving keys and values out of the map, which is left empty
+    template<typename Func>
+    void drain(Func&& func) {
+        for (std::size_t i = 0; i < m_hashes.size(); ++i) {
+            if (m_hashes[i] != 0) {
+                func(m_hashes[i], std::move(m_keys[i]), std::move(m_values[i]));
+            }
+        }
+        *this = flat_hash_map();
+    }
+
+    key_value_iterator keyValueBegin() const { return {this, next_used(0)}; }
+    key_value_iterator keyValueEnd() const { return {this, m_hashes.size()}; }
+
+private:
+    std::size_t next_used(std::size_t i) const {
+        while (i < m_hashes.size() && m_hashes[i] == 0) {
+            ++i;
+        }
+        return i;
+    }
+
+    void rehash(std::size_t capacity) {
+        std::size_t size = 16;
+        while (size < capacity) {
+            size *= 2;
+        }
+        std::vector<std::uint64_t> hashes(size, 0);
+        std::vector<K> keys(size);
+        std::vector<V> values(size);
+        const std::size_t mask = size - 1;
+        for (std::size_t i = 0; i < m_hashes.size(); ++i) {
+            if (m_hashes[i] != 0) {
+                std::size_t j = m_hashes[i] & mask;
+                while (hashes[j] != 0) {
+                    j = (j + 1) & mask;
+                }
+                hashes[j] = m_hashes[i];
+                keys[j] = std::move(m_keys[i]);
+                values[j] = std::move(m_values[i]);
+            }
+        }
+        m_hashes.swap(hashes);
+        m_keys.swap(keys);
+        m_values.swap(values);
+        m_mask = mask;
+    }
+
+    std::vector<std::uint64_t> m_hashes;
+    std::vector<K> m_keys;
+    std::vector<V> m_values;
+    std::size_t m_mask = 0;
+    std::size_t m_size = 0;
+};
+
+/**
+ * @brief Result of aggregate_by(): a hash map split into partitions by the high bits of the key hashes.
+ *
+ * It can be iterated with make_keyval() like a QHash, which yields std::pair<const K&, const V&> in no particular order.
+ */
+template<typename K, typename V>
+class hash_aggregate_map {
+public:
+    struct key_value_iterator {
+        using inner_iterator = typename flat_hash_map<K, V>::key_value_iterator;
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename inner_iterator::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        value_type operator*() const { return *m_inner; }
+        key_value_iterator& operator++() { ++m_inner; skip_empty(); return *this; }
+        key_value_iterator operator++(int) { key_value_iterator it = *this; ++*this; return it; }
+        friend bool operator==(const key_value_iterator& lhs, const key_value_iterator& rhs) { return lhs.m_partition == rhs.m_partition && (lhs.at_end() || lhs.m_inner == rhs.m_inner); }
+        friend bool operator!=(const key_value_iterator& lhs, const key_value_iterator& rhs) { return !(lhs == rhs); }
+
+        bool at_end() const { return m_partition == m_map->m_partitions.size(); }
+
+        void skip_empty() {
+            while (m_partition < m_map->m_partitions.size() && m_inner == m_map->m_partitions[m_partition].keyValueEnd()) {
+                if (++m_partition < m_map->m_partitions.size()) {
+                    m_inner = m_map->m_partitions[m_partition].keyValueBegin();
+                }
+            }
+        }
+
+        const hash_aggregate_map* m_map;
+        std::size_t m_partition;
+        inner_iterator m_inner;
+    };
+
+    explicit hash_aggregate_map(unsigned partitionBits) : m_partitionBits(partitionBits), m_partitions(std::size_t(1) << partitionBits) {}
+
+    std::size_t size() const {
+        std::size_t size = 0;
+        for (const auto& partition : m_partitions) {
+            size += partition.size();
+        }
+        return size;
+    }
+
+    std::size_t partition_count() const { return m_partitions.size(); }
+    std::size_t partition_of(std::uint64_t hash) const { return m_partitionBits == 0 ? 0 : static_cast<std::size_t>(hash >> (64 - m_partitionBits)); }
+    flat_hash_map<K, V>& partition(std::size_t index) { return m_partitions[index]; }
+
+    const V* find(const K& key) const {
+        const std::uint64_t hash = hash_key(key);
+        return m_partitions[partition_of(hash)].find_hashed(hash, key);
+    }
+
+    key_value_iterator keyValueBegin() const {
+        key_value_iterator it{this, 0, m_partitions.front().keyValueBegin()};
+        it.skip_empty();
+        return it;
+    }
+    key_value_iterator keyValueEnd() const { return {this, m_partitions.size(), m_partitions.back().keyValueEnd()}; }
+
+private:
+    unsigned m_partitionBits;
+    std::vector<flat_hash_map<K, V>> m_partitions;
+};
+
+// Aggregates for aggregate_by(): init() creates the accumulator from the first value of a key, add() folds in the next ones,
+// and merge() combines the partial accumulators computed by different threads
+
+struct sum_aggregate {
+    template<typename V> using accumulator = V;
+    template<typename V> V init(V value) const { return value; }
+    template<typename A, typename V> void add(A& acc, const V& value) const { acc += value; }
+    template<typename A> void merge(A& acc, const A& other) const { acc += other; }
+};
+
+struct count_aggregate {
+    template<typename V> using accumulator = std::size_t;
+    template<typename V> std::size_t init(const V&) const { return 1; }
+    template<typename V> void add(std::size_t& acc, const V&) const { ++acc; }
+    void merge(std::size_t& acc, std::size_t other) const { acc += other; }
+};
+
+struct min_aggregate {
+    template<typename V> using accumulator = V;
+    template<typename V> V init(V value) const { return value; }
+    template<typename A, typename V> void add(A& acc, const V& value) const { if (value < acc) acc = value; }
+    template<typename A> void merge(A& acc, const A& other) const { add(acc, other); }
+};
+
+struct max_aggregate {
+    template<typename V> using accumulator = V;
+    template<typename V> V init(V value) const { return value; }
+    template<typename A, typename V> void add(A& acc, const V& value) const { if (acc < value) acc = value; }
+    template<typename A> void merge(A& acc, const A& other) const { add(acc, other); }
+};
+
+// Custom aggregate from an associative binary combiner, used both to fold values and to merge partial results
+template<typename Combine>
+struct combine_aggregate {
+    template<typename V> using accumulator = V;
+    template<typename V> V init(V value) const { return value; }
+    template<typename A, typename V> void add(A& acc, V&& value) const { acc = m_combine(std::move(acc), std::forward<V>(value)); }
+    template<typename A> void merge(A& acc, A& other) const { acc = m_combine(std::move(acc), std::move(other)); }
+
+    Combine m_combine;
+};
+
+template<typename Combine>
+combine_aggregate<Combine> make_aggregate(Combine combine) { return {std::move(combine)}; }
+
+/**
+ * @brief This helper groups the elements of any splittable view by key, and aggregates their values per key in parallel.
+ *
+ * Each worker of the shared work-stealing pool aggregates its pieces of the view into its own set of open-addressing tables,
+ * one per partition of the key hash space, so there's no sharing between threads in the hot loop. The partitions
+ * are then merged in parallel, each one by a single worker. The result can be iterated with make_keyval().
+ *
+ * Available aggregates are sum_aggregate, count_aggregate, min_aggregate, max_aggregate, and make_aggregate() for
+ * any associative combiner. Like parallel_for_each(), this takes any range_utils adapter: plain containers
+ * can be passed through make_reversible().
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * const QVector<int> customers = ...;
+ * const QVector<double> amounts = ...;
+ * auto totals = aggregate_by(make_synchronized(customers, amounts),
+ *                            [](const auto& row) { return std::get<0>(row); },
+ *                            [](const auto& row) { return std::get<1>(row); },
+ *                            sum_aggregate());
+ * for (auto [customer, total] : make_keyval(totals)) {
+ *     qDebug() << customer << "->" << total;
+ * }
+ * @endcode
+ */
+template<typename View, typename KeyFunc, typename ValueFunc, typename Aggregate>
+auto aggregate_by(View&& view, KeyFunc&& keyFunc, ValueFunc&& valueFunc, Aggregate aggregate, std::size_t grain = 0, work_stealing_pool& pool = work_stealing_pool::shared()) -> hash_aggregate_map<std::decay_t<decltype(keyFunc(*view.begin()))>, typename Aggregate::template accumulator<std::decay_t<decltype(valueFunc(*view.begin()))>>> {
+    using element_type = decltype(*view.begin());
+    using key_type = std::decay_t<decltype(keyFunc(std::declval<element_type>()))>;
+    using value_type = std::decay_t<decltype(valueFunc(std::declval<element_type>()))>;
+    using accumulator_type = typename Aggregate::template accumulator<value_type>;
+
+    // A few partitions per worker, so that the merge phase balances well
+    unsigned partitionBits = 0;
+    while ((1u << partitionBits) < pool.size() * 4) {
+        ++partitionBits;
+    }
+    hash_aggregate_map<key_type, accumulator_type> result(partitionBits);
+
+    // One set of tables per worker, plus one for the calling thread when the view is too small to be split
+    std::vector<std::vector<flat_hash_map<key_type, accumulator_type>>> locals(pool.size() + 1, std::vector<flat_hash_map<key_type, accumulator_type>>(result.partition_count()));
+    parallel_for_each_chunk(view, [&](auto&& chunk) {
+        auto& tables = locals[static_cast<std::size_t>(pool.current_worker_index() + 1)];
+        for (auto&& element : chunk) {
+            auto&& key = keyFunc(element);
+            const std::uint64_t hash = hash_key(key);
+            auto slot = tables[result.partition_of(hash)].try_emplace_hashed(hash, key);
+            if (slot.second) {
+                *slot.first = aggregate.init(valueFunc(element));
+            } else {
+                aggregate.add(*slot.first, valueFunc(element));
+            }
+        }
+    }, grain, pool);
+
+    parallel_for(std::size_t(0), result.partition_count(), std::size_t(1), [&](std::size_t first, std::size_t last) {
+        for (std::size_t p = first; p < last; ++p) {
+            auto& target = result.partition(p);
+            for (auto& tables : locals) {
+                if (target.empty()) {
+                    std::swap(target, tables[p]);
+                    continue;
+                }
+                tables[p].drain([&](std::uint64_t hash, key_type&& key, accumulator_type&& acc) {
+                    auto slot = target.try_emplace_hashed(hash, key);
+                    if (slot.second) {
+                        *slot.first = std::move(acc);
+                    } else {
+                        aggregate.merge(*slot.first, acc);
+                    }
+                });
+            }
+        }
+    }, pool);
+    return result;
+}
+
+/**
+ * @brief Result of make_partitioned(): a range of partitions, each one a std::vector of the elements whose key hash maps to it.
+ */
+template<typename T, typename Allocator = std::allocator<T>>
+class partitioned_range {
+public:
+    using value_type = std::vector<T, Allocator>;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+    using iterator = const_iterator;
+
+    explicit partitioned_range(std::size_t fanout, const Allocator& allocator = Allocator()) : m_partitions(fanout, value_type(allocator)) {}
+
+    const_iterator begin() const { return m_partitions.begin(); }
+    const_iterator end() const { return m_partitions.end(); }
+    std::size_t size() const { return m_partitions.size(); }
+    const value_type& operator[](std::size_t index) const { return m_partitions[index]; }
+    value_type& operator[](std::size_t index) { return m_partitions[index]; }
+
+    // Maps the top 32 bits of the hash to [0, size()) without a division. For a power of two fanout,
+    // this is the same partition as the one picked by aggregate_by() with the same number of partitions.
+    std::size_t partition_of(std::uint64_t hash) const { return static_cast<std::size_t>(((hash >> 32) * m_partitions.size()) >> 32); }
+
+private:
+    std::vector<value_type> m_partitions;
+};
+
+/**
+ * @brief This overload of make_partitioned() (see below) takes the partitions and the staging buffers from a standard allocator,
+ * like arena_allocator.
+ *
+ * It is declared first, since the other overloads forward to it.
+ */
+template<typename R, typename KeyFunc, typename Allocator>
+auto make_partitioned(R&& range, KeyFunc&& keyFunc, std::size_t fanout, const Allocator& allocator) {
+    using T = std::decay_t<decltype(*std::begin(range))>;
+    using element_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+    using count_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::size_t>;
+    static constexpr std::size_t BufferBytes = 256;
+    static constexpr std::size_t BufferSize = sizeof(T) >= BufferBytes ? 1 : BufferBytes / sizeof(T);
+
+    partitioned_range<T, element_allocator> result(std::max<std::size_t>(fanout, 1), element_allocator(allocator));
+    std::vector<T, element_allocator> buffers(result.size() * BufferSize, element_allocator(allocator));
+    std::vector<std::size_t, count_allocator> counts(result.size(), 0, count_allocator(allocator));
+    for (auto&& element : range) {
+        const std::size_t p = result.partition_of(hash_key(keyFunc(element)));
+        T* buffer = &buffers[p * BufferSize];
+        buffer[counts[p]] = std::forward<decltype(element)>(element);
+        if (++counts[p] == BufferSize) {
+            result[p].insert(result[p].end(), std::make_move_iterator(buffer), std::make_move_iterator(buffer + BufferSize));
+            counts[p] = 0;
+        }
+    }
+    for (std::size_t p = 0; p < result.size(); ++p) {
+        T* buffer = &buffers[p * BufferSize];
+        result[p].insert(result[p].end(), std::make_move_iterator(buffer), std::make_move_iterator(buffer + counts[p]));
+    }
+    return result;
+}
+
+/**
+ * @brief This helper scatters the elements of a range into @p fanout partitions by key hash, in a single pass.
+ *
+ * Elements are first staged in a small write-combining buffer per partition, and only copied to the partition
+ * when a buffer is full, so the scattered writes stay within a few cache lines instead of touching
+ * @p fanout destinations at random. Partitioning a large input first keeps the later per-partition hash joins
+ * or aggregations within the cache. Elements are copied or moved in, and must be default-constructible.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * auto partitions = make_partitioned(orders, [](const Order& order) { return order.customerId; }, 64);
+ * parallel_for(std::size_t(0), partitions.size(), std::size_t(1), [&](std::size_t first, std::size_t last) {
+ *     for (std::size_t p = first; p < last; ++p)
+ *         joinWithCustomers(partitions[p]); // all the orders of a customer are in the same partition
+ * });
+ * @endcode
+ */
+template<typename R, typename KeyFunc>
+auto make_partitioned(R&& range, KeyFunc&& keyFunc, std::size_t fanout) { return make_partitioned(std::forward<R>(range), keyFunc, fanout, std::allocator<std::decay_t<decltype(*std::begin(range))>>()); }
+
+/**
+ * @brief This overload allocates the partitions and the staging buffers in an arena.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * arena_scope scope;
+ * auto partitions = make_partitioned(orders, [](const Order& order) { return order.customerId; }, 64, scope.arena());
+ * @endcode
+ */
+template<typename R, typename KeyFunc>
+auto make_partitioned(R&& range, KeyFunc&& keyFunc, std::size_t fanout, monotonic_arena& arena) {
+    return make_partitioned(std::forward<R>(range), keyFunc, fanout, arena_allocator<std::decay_t<decltype(*std::begin(range))>>(arena));
+}
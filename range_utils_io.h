@@ -0,0 +1,594 @@
+#pragma once
+
+#include "range_utils.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define RANGE_UTILS_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// RAII wrapper for a POSIX file descriptor, throwing std::system_error when the file can't be opened
+class file_descriptor {
+public:
+    file_descriptor() = default;
+    file_descriptor(const std::string& path, int flags, mode_t mode = 0644) : m_fd(::open(path.c_str(), flags | O_CLOEXEC, mode)) {
+        if (m_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+    }
+    file_descriptor(file_descriptor&& other) noexcept : m_fd(other.m_fd) { other.m_fd = -1; }
+    file_descriptor& operator=(file_descriptor&& other) noexcept { std::swap(m_fd, other.m_fd); return *this; }
+    ~file_descriptor() { if (m_fd >= 0) ::close(m_fd); }
+
+    int get() const { return m_fd; }
+
+    std::uint64_t size() const {
+        struct stat st;
+        if (::fstat(m_fd, &st) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fstat");
+        }
+        return static_cast<std::uint64_t>(st.st_size);
+    }
+
+private:
+    int m_fd = -1;
+};
+
+/**
+ * @brief Read-only memory mapping of a whole file, throwing std::system_error when the file can't be opened or mapped.
+ *
+ * The mapping stays valid after the file descriptor is closed. Pass @p sequential = false for random access patterns,
+ * so the kernel doesn't read ahead aggressively.
+ */
+class mapped_file {
+public:
+    explicit mapped_file(const std::string& path, bool sequential = true) {
+        const file_descriptor file(path, O_RDONLY);
+        m_size = static_cast<std::size_t>(file.size());
+        if (m_size == 0) {
+            return; // mmap() rejects empty mappings
+        }
+        void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file.get(), 0);
+        if (data == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap " + path);
+        }
+        ::madvise(data, m_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        m_data = static_cast<const char*>(data);
+    }
+    mapped_file(mapped_file&& other) noexcept : m_data(other.m_data), m_size(other.m_size) { other.m_data = nullptr; other.m_size = 0; }
+    mapped_file& operator=(mapped_file&& other) noexcept { std::swap(m_data, other.m_data); std::swap(m_size, other.m_size); return *this; }
+    ~mapped_file() { if (m_data) ::munmap(const_cast<char*>(m_data), m_size); }
+
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+/**
+ * @brief Asynchronous reader for a fixed set of buffer slots: each slot has at most one read in flight.
+ */
+class block_reader {
+public:
+    virtual ~block_reader() = default;
+    // Starts reading @p size bytes at @p offset into @p buffer, on behalf of @p slot
+    virtual void submit(unsigned slot, char* buffer, std::size_t size, std::uint64_t offset) = 0;
+    // Waits for the read on @p slot, and returns the number of bytes read or a negative errno value
+    virtual long wait(unsigned slot) = 0;
+};
+
+/**
+ * @brief Portable fallback, where a background thread performs the reads with pread() in submission order.
+ */
+class pread_block_reader : public block_reader {
+public:
+    pread_block_reader(int fd, unsigned slotCount) : m_fd(fd), m_results(slotCount), m_thread([this] { run(); }) {}
+    ~pread_block_reader() override {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+    }
+
+    void submit(unsigned slot, char* buffer, std::size_t size, std::uint64_t offset) override {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_results[slot] = pending;
+            m_requests.push_back({slot, buffer, size, offset});
+        }
+        m_condition.notify_all();
+    }
+
+    long wait(unsigned slot) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [&] { return m_results[slot] != pending; });
+        return m_results[slot];
+    }
+
+private:
+    static constexpr long pending = -1 - 0x7fffffffL;
+
+    struct request {
+        unsigned m_slot;
+        char* m_buffer;
+        std::size_t m_size;
+        std::uint64_t m_offset;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_condition.wait(lock, [&] { return m_stopping || !m_requests.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            const request r = m_requests.front();
+            m_requests.pop_front();
+            lock.unlock();
+            long result = 0;
+            while (static_cast<std::size_t>(result) < r.m_size) {
+                const ssize_t n = ::pread(m_fd, r.m_buffer + result, r.m_size - result, static_cast<off_t>(r.m_offset + result));
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    result = n < 0 ? -errno : result;
+                    break;
+                }
+                result += n;
+            }
+            lock.lock();
+            m_results[r.m_slot] = result;
+            m_condition.notify_all();
+        }
+    }
+
+    int m_fd;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<request> m_requests;
+    std::vector<long> m_results;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
+
+#ifdef RANGE_UTILS_HAS_IO_URING
+/**
+ * @brief Linux io_uring backend, using the raw system calls so that there's no dependency on liburing.
+ *
+ * Throws std::system_error if io_uring isn't available (old kernel, seccomp filters...), so that callers can fall back to pread_block_reader.
+ */
+class io_uring_block_reader : public block_reader {
+public:
+    io_uring_block_reader(int fd, unsigned slotCount) : m_fd(fd), m_iovecs(slotCount), m_offsets(slotCount), m_results(slotCount), m_completed(slotCount, true) {
+        try {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            m_ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, slotCount, &params));
+            if (m_ringFd < 0) {
+                throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+            }
+            m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (singleMmap) {
+                m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+            }
+            m_sqRing = map(m_sqRingSize, IORING_OFF_SQ_RING);
+            m_cqRing = singleMmap ? m_sqRing : map(m_cqRingSize, IORING_OFF_CQ_RING);
+            m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            m_sqes = static_cast<io_uring_sqe*>(map(m_sqesSize, IORING_OFF_SQES));
+
+            char* sq = static_cast<char*>(m_sqRing);
+            m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            char* cq = static_cast<char*>(m_cqRing);
+            m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~io_uring_block_reader() override {
+        // Reads still in flight target buffers owned by the caller, so they must complete before the buffers are released
+        try {
+            for (unsigned slot = 0; slot < m_completed.size(); ++slot) {
+                if (!m_completed[slot]) {
+                    wait(slot);
+                }
+            }
+        } catch (const std::system_error&) {
+        }
+        release();
+    }
+
+    void submit(unsigned slot, char* buffer, std::size_t size, std::uint64_t offset) override {
+        m_iovecs[slot] = {buffer, size};
+        m_offsets[slot] = offset;
+        m_completed[slot] = false;
+
+        const unsigned tail = *m_sqTail; // Only written by us
+        const unsigned index = tail & m_sqMask;
+        io_uring_sqe& sqe = m_sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV; // Rather than IORING_OP_READ, which requires Linux 5.6
+        sqe.fd = m_fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&m_iovecs[slot]);
+        sqe.len = 1;
+        sqe.off = offset;
+        sqe.user_data = slot;
+        m_sqArray[index] = index;
+        __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        int submitted;
+        while ((submitted = enter(1, 0, 0)) < 0 && (errno == EINTR || errno == EAGAIN)) {
+        }
+        if (submitted < 0) {
+            // The kernel only consumes entries in io_uring_enter(), and hasn't consumed this one since it failed, so take it back.
+            // Otherwise the next submit() would submit it instead of its own, and the destructor would wait for it forever.
+            const int error = errno;
+            __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+            m_results[slot] = -error;
+            m_completed[slot] = true;
+            throw std::system_error(error, std::generic_category(), "io_uring_enter");
+        }
+    }
+
+    long wait(unsigned slot) override {
+        while (!m_completed[slot]) {
+            unsigned head = *m_cqHead;
+            const unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            if (head == tail) {
+                if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                    throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+                }
+                continue;
+            }
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+                m_results[cqe.user_data] = cqe.res;
+                m_completed[cqe.user_data] = true;
+            }
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        }
+        long result = m_results[slot];
+        // Regular files only return short reads at end of file, but complete any other short read synchronously to be safe
+        const iovec& iov = m_iovecs[slot];
+        while (result > 0 && static_cast<std::size_t>(result) < iov.iov_len) {
+            const ssize_t n = ::pread(m_fd, static_cast<char*>(iov.iov_base) + result, iov.iov_len - result, static_cast<off_t>(m_offsets[slot] + result));
+            if (n <= 0) {
+                break;
+            }
+            result += n;
+        }
+        return result;
+    }
+
+private:
+    void release() {
+        if (m_sqes) ::munmap(m_sqes, m_sqesSize);
+        if (m_cqRing && m_cqRing != m_sqRing) ::munmap(m_cqRing, m_cqRingSize);
+        if (m_sqRing) ::munmap(m_sqRing, m_sqRingSize);
+        if (m_ringFd >= 0) ::close(m_ringFd);
+    }
+
+    void* map(std::size_t size, off_t offset) {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, offset);
+        if (p == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "io_uring mmap");
+        }
+        return p;
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) { return static_cast<int>(::syscall(__NR_io_uring_enter, m_ringFd, toSubmit, minComplete, flags, nullptr, 0)); }
+
+    int m_fd;
+    int m_ringFd = -1;
+    std::vector<iovec> m_iovecs;
+    std::vector<std::uint64_t> m_offsets;
+    std::vector<long> m_results;
+    std::vector<bool> m_completed;
+
+    void* m_sqRing = nullptr;
+    void* m_cqRing = nullptr;
+    io_uring_sqe* m_sqes = nullptr;
+    std::size_t m_sqRingSize = 0;
+    std::size_t m_cqRingSize = 0;
+    std::size_t m_sqesSize = 0;
+    unsigned* m_sqTail = nullptr;
+    unsigned* m_sqArray = nullptr;
+    unsigned m_sqMask = 0;
+    unsigned* m_cqHead = nullptr;
+    unsigned* m_cqTail = nullptr;
+    unsigned m_cqMask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+};
+#endif
+
+struct file_block {
+    const char* data;
+    std::size_t size;
+    std::uint64_t offset;
+};
+
+struct file_read_options {
+    std::size_t blockSize = 1 << 20;  // Rounded up to a multiple of 4096
+    unsigned readAhead = 4;           // Blocks read in the background while the loop body processes the current one
+    bool useIoUring = true;           // Falls back to a pread() thread if io_uring isn't available anyway
+};
+
+class file_block_range {
+public:
+    file_block_range(const std::string& path, file_read_options options = file_read_options())
+        : m_file(path, O_RDONLY), m_fileSize(m_file.size()), m_blockSize((std::max<std::size_t>(options.blockSize, 1) + 4095) / 4096 * 4096),
+          m_blockCount((m_fileSize + m_blockSize - 1) / m_blockSize), m_slotCount(options.readAhead + 1),
+          m_buffers(static_cast<char*>(aligned_alloc(4096, m_blockSize * m_slotCount))), m_blocks(m_slotCount) {
+        if (!m_buffers) {
+            throw std::bad_alloc();
+        }
+#ifdef RANGE_UTILS_HAS_IO_URING
+        if (options.useIoUring) {
+            try {
+                m_reader.reset(new io_uring_block_reader(m_file.get(), m_slotCount));
+            } catch (const std::system_error&) {
+            }
+        }
+#endif
+        if (!m_reader) {
+#ifdef POSIX_FADV_SEQUENTIAL
+            ::posix_fadvise(m_file.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+            m_reader.reset(new pread_block_reader(m_file.get(), m_slotCount));
+        }
+    }
+
+    file_block_range(file_block_range&&) = default;
+
+    /**
+     * @brief This is a single-pass input iterator over the blocks, each one valid until the iterator is incremented
+     */
+    struct iterator {
+        const file_block& operator*() const { return m_range->m_blocks[m_range->m_current % m_range->m_slotCount]; }
+        const file_block* operator->() const { return &**this; }
+        iterator& operator++() { m_range->advance(); return *this; }
+
+        friend bool operator!=(const iterator& lhs, const iterator& rhs) { return lhs.at_end() != rhs.at_end(); }
+        friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.at_end() == rhs.at_end(); }
+        bool at_end() const { return !m_range || m_range->m_current >= m_range->m_blockCount; }
+
+        file_block_range* m_range;
+    };
+
+    iterator begin() {
+        if (!m_started) {
+            m_started = true;
+            for (std::uint64_t block = 0; block < std::min<std::uint64_t>(m_slotCount, m_blockCount); ++block) {
+                submit(block);
+            }
+            complete(m_current);
+        }
+        return {this};
+    }
+    iterator end() { return {nullptr}; }
+
+    std::uint64_t file_size() const { return m_fileSize; }
+    std::size_t block_size() const { return m_blockSize; }
+    bool uses_io_uring() const { return dynamic_cast<const pread_block_reader*>(m_reader.get()) == nullptr; }
+
+private:
+    struct free_deleter {
+        void operator()(char* p) const { std::free(p); }
+    };
+
+    static void* aligned_alloc(std::size_t alignment, std::size_t size) {
+        void* p = nullptr;
+        return ::posix_memalign(&p, alignment, size) == 0 ? p : nullptr;
+    }
+
+    void submit(std::uint64_t block) {
+        const unsigned slot = static_cast<unsigned>(block % m_slotCount);
+        const std::uint64_t offset = block * m_blockSize;
+        m_blocks[slot] = {m_buffers.get() + slot * m_blockSize, static_cast<std::size_t>(std::min<std::uint64_t>(m_blockSize, m_fileSize - offset)), offset};
+        m_reader->submit(slot, m_buffers.get() + slot * m_blockSize, m_blocks[slot].size, offset);
+    }
+
+    void complete(std::uint64_t block) {
+        if (block >= m_blockCount) {
+            return;
+        }
+        const unsigned slot = static_cast<unsigned>(block % m_slotCount);
+        const long result = m_reader->wait(slot);
+        if (result < 0) {
+            throw std::system_error(static_cast<int>(-result), std::generic_category(), "read");
+        }
+        m_blocks[slot].size = static_cast<std::size_t>(result); // The file may have been truncated meanwhile
+    }
+
+    void advance() {
+        // The slot of the block that was just processed can now receive the next block to read ahead
+        if (m_current + m_slotCount < m_blockCount) {
+            submit(m_current + m_slotCount);
+        }
+        complete(++m_current);
+    }
+
+    file_descriptor m_file;
+    std::uint64_t m_fileSize;
+    std::size_t m_blockSize;
+    std::uint64_t m_blockCount;
+    unsigned m_slotCount;
+    std::unique_ptr<char, free_deleter> m_buffers;
+    std::vector<file_block> m_blocks;
+    std::unique_ptr<block_reader> m_reader; // Declared after the buffers, so that pending reads complete before they are freed
+    std::uint64_t m_current = 0;
+    bool m_started = false;
+};
+
+/**
+ * @brief This helper iterates over the fixed-size blocks of a file within a range-for loop, reading the next blocks in the background.
+ *
+ * While the loop body processes the current block, the next file_read_options::readAhead blocks are already being read
+ * asynchronously (with io_uring on Linux, or with pread() on a background thread otherwise), so that CPU work and I/O
+ * waits overlap. Each file_block is only valid until the loop moves on to the next one.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * std::uint64_t checksum = 0;
+ * for (const file_block& block : make_file_blocks("/data/ticks.bin")) {
+ *     checksum = crc64(checksum, block.data, block.size);
+ * }
+ * @endcode
+ */
+inline file_block_range make_file_blocks(const std::string& path, file_read_options options = file_read_options()) { return file_block_range(path, options); }
+
+/**
+ * @brief Random-access iterator over the records of a record_range, yielding references into the mapping.
+ */
+template<typename T>
+struct record_iterator {
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    reference operator*() const { return *m_ptr; }
+    pointer operator->() const { return m_ptr; }
+    reference operator[](difference_type n) const { return m_ptr[n]; }
+
+    record_iterator& operator++() { ++m_ptr; return *this; }
+    record_iterator operator++(int) { return {m_ptr++}; }
+    record_iterator& operator--() { --m_ptr; return *this; }
+    record_iterator operator--(int) { return {m_ptr--}; }
+    record_iterator& operator+=(difference_type n) { m_ptr += n; return *this; }
+    record_iterator& operator-=(difference_type n) { m_ptr -= n; return *this; }
+    friend record_iterator operator+(record_iterator it, difference_type n) { return {it.m_ptr + n}; }
+    friend record_iterator operator+(difference_type n, record_iterator it) { return {it.m_ptr + n}; }
+    friend record_iterator operator-(record_iterator it, difference_type n) { return {it.m_ptr - n}; }
+    friend difference_type operator-(record_iterator lhs, record_iterator rhs) { return lhs.m_ptr - rhs.m_ptr; }
+
+    friend bool operator==(record_iterator lhs, record_iterator rhs) { return lhs.m_ptr == rhs.m_ptr; }
+    friend bool operator!=(record_iterator lhs, record_iterator rhs) { return lhs.m_ptr != rhs.m_ptr; }
+    friend bool operator<(record_iterator lhs, record_iterator rhs) { return lhs.m_ptr < rhs.m_ptr; }
+    friend bool operator>(record_iterator lhs, record_iterator rhs) { return lhs.m_ptr > rhs.m_ptr; }
+    friend bool operator<=(record_iterator lhs, record_iterator rhs) { return lhs.m_ptr <= rhs.m_ptr; }
+    friend bool operator>=(record_iterator lhs, record_iterator rhs) { return lhs.m_ptr >= rhs.m_ptr; }
+
+    const T* m_ptr;
+};
+
+/**
+ * @brief Read-only container view over a memory-mapped file holding an array of T, with the usual STL container typedefs.
+ *
+ * Copies share the mapping, which is released with the last one.
+ */
+template<typename T>
+class record_range {
+    static_assert(std::is_trivially_copyable<T>::value, "record_range requires a trivially copyable record type");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using const_reference = const T&;
+    using reference = const_reference;
+    using const_iterator = record_iterator<T>;
+    using iterator = const_iterator;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using reverse_iterator = const_reverse_iterator;
+
+    explicit record_range(const std::string& path) {
+        auto file = std::make_shared<const mapped_file>(path, false);
+        if (file->size() % sizeof(T) != 0) {
+            throw std::runtime_error("make_records: the size of " + path + " (" + std::to_string(file->size()) + " bytes) is not a multiple of the record size (" + std::to_string(sizeof(T)) + " bytes)");
+        }
+        if (reinterpret_cast<std::uintptr_t>(file->data()) % alignof(T) != 0) {
+            throw std::runtime_error("make_records: the mapping of " + path + " is not aligned for the record type");
+        }
+        m_data = reinterpret_cast<const T*>(file->data());
+        m_size = file->size() / sizeof(T);
+        m_owner = std::move(file);
+    }
+
+    // Views @p size records at @p data, kept alive by @p owner (which may be null if the caller guarantees the lifetime)
+    record_range(std::shared_ptr<const void> owner, const T* data, std::size_t size) : m_owner(std::move(owner)), m_data(data), m_size(size) {}
+
+    const T* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const T& operator[](std::size_t index) const { return m_data[index]; }
+
+    const_iterator begin() const { return {m_data}; }
+    const_iterator end() const { return {m_data + m_size}; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crbegin() const { return rbegin(); }
+    const_reverse_iterator crend() const { return rend(); }
+
+    // Split protocol, see range_slice
+    std::size_t size_hint() const { return m_size; }
+    auto split() const { return make_range_slice(begin(), end(), m_size).split(); }
+
+private:
+    std::shared_ptr<const void> m_owner; // Keeps the mapping alive
+    const T* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+/**
+ * @brief This helper maps a file holding an array of trivially copyable T, and iterates over it as a random-access range of `const T&`.
+ *
+ * Records are read in place from the mapping, without any copy. The file size must be a multiple of sizeof(T),
+ * otherwise std::runtime_error is thrown at open. The records are in the native layout and byte order,
+ * so the file must have been written from the same T on the same platform.
+ * The range works with make_reversible(), make_synchronized() and parallel_for_each().
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * struct Tick { std::int64_t time; double price; std::int32_t volume; std::int32_t flags; };
+ *
+ * for (const Tick& tick : make_reversible(make_records<Tick>("/data/ticks.bin"))) {
+ *     if (tick.flags & Tick::Close)
+ *         return tick.price; // last closing price
+ * }
+ * @endcode
+ */
+template<typename T>
+record_range<T> make_records(const std::string& path) { return record_range<T>(path); }
@@ -0,0 +1,396 @@
+#pragma once
+
+#include "range_utils_io.h"
+
+#if __cplusplus < 201703L
+#error "range_utils_output.h requires C++17"
+#endif
+
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+struct file_write_options {
+    std::size_t bufferSize = 1 << 20;  // Rounded up to a multiple of 4096, and at least 2 pages
+    bool background = true;            // Writes a full buffer on a background thread while the next one is filled
+    bool directIo = false;             // Opens files with O_DIRECT to bypass the page cache, where the file system supports it
+};
+
+/**
+ * @brief Buffered output to a file, a file descriptor or a std::ostream, through large page-aligned buffers.
+ *
+ * With file_write_options::background, two buffers are used: a full one is written by a background thread
+ * while the caller fills the other one. With file_write_options::directIo, only whole pages are written,
+ * and the file is padded then truncated to its actual size when the sink is closed.
+ *
+ * Write errors are thrown as std::system_error from the next call that hands a buffer over, or from close().
+ * The destructor closes the sink too, but has to ignore errors, so close() should be called explicitly.
+ */
+class output_sink {
+public:
+    static constexpr std::size_t Alignment = 4096;
+
+    explicit output_sink(const std::string& path, file_write_options options = file_write_options()) : output_sink(options) {
+        m_file = open_for_writing(path, options.directIo);
+        m_fd = m_file.get();
+        start(options);
+    }
+    // The file descriptor is not closed by the sink
+    explicit output_sink(int fd, file_write_options options = file_write_options()) : output_sink(options) { m_fd = fd; start(options); }
+    explicit output_sink(std::ostream& stream, file_write_options options = file_write_options()) : output_sink(options) { m_stream = &stream; start(options); }
+
+    output_sink(const output_sink&) = delete;
+    output_sink& operator=(const output_sink&) = delete;
+    ~output_sink() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+    void write(const void* data, std::size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            const std::size_t count = std::min(size, m_capacity - m_used);
+            std::memcpy(m_current + m_used, bytes, count);
+            m_used += count;
+            bytes += count;
+            size -= count;
+            if (m_used == m_capacity) {
+                hand_over();
+            }
+        }
+    }
+
+    void put(char c) {
+        if (m_used >= m_capacity) {
+            hand_over();
+        }
+        m_current[m_used++] = c;
+    }
+
+    // Returns room for at least @p size <= Alignment bytes, to be formatted in place and then committed
+    // A single hand-over is enough, since it carries less than a page over to a buffer of at least 2 pages
+    char* reserve(std::size_t size) {
+        if (m_capacity - m_used < size) {
+            hand_over();
+        }
+        return m_current + m_used;
+    }
+    void commit(std::size_t size) { m_used += size; }
+
+    std::uint64_t size() const { return m_written + m_used; }
+
+    // Writes everything buffered so far, except the last partial page with O_DIRECT
+    void flush() {
+        if (m_used > 0) {
+            hand_over();
+        }
+        wait_idle();
+        if (m_stream) {
+            m_stream->flush();
+        }
+    }
+
+    void close() {
+        if (m_closed) {
+            return;
+        }
+        m_closed = true;
+        std::exception_ptr error;
+        const std::size_t used = m_used;
+        try {
+            std::size_t size = used;
+            if (m_direct) {
+                size = (used + Alignment - 1) / Alignment * Alignment;
+                std::memset(m_current + used, 0, size - used);
+            }
+            submit(m_current, size);
+            wait_idle();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        stop();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        m_written += used;
+        m_used = 0;
+        if (m_direct && ::ftruncate(m_fd, static_cast<off_t>(m_written)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "ftruncate");
+        }
+        if (m_stream) {
+            m_stream->flush();
+        }
+    }
+
+private:
+    struct buffer_deleter {
+        void operator()(char* buffer) const { std::free(buffer); }
+    };
+    using buffer_ptr = std::unique_ptr<char, buffer_deleter>;
+
+    // With O_DIRECT, the partial last page is carried over to the next buffer, so there must be room for another page after it
+    explicit output_sink(file_write_options options) : m_capacity((std::max<std::size_t>(options.bufferSize, 2 * Alignment) + Alignment - 1) / Alignment * Alignment) {}
+
+    file_descriptor open_for_writing(const std::string& path, bool directIo) {
+#ifdef O_DIRECT
+        if (directIo) {
+            try {
+                file_descriptor file(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT);
+                m_direct = true;
+                return file;
+            } catch (const std::system_error& e) {
+                if (e.code().value() != EINVAL) { // Like on tmpfs
+                    throw;
+                }
+            }
+        }
+#endif
+        (void) directIo;
+        return file_descriptor(path, O_WRONLY | O_CREAT | O_TRUNC);
+    }
+
+    void start(const file_write_options& options) {
+        for (int i = 0; i < (options.background ? 2 : 1); ++i) {
+            void* buffer = nullptr;
+            if (::posix_memalign(&buffer, Alignment, m_capacity) != 0) {
+                throw std::bad_alloc();
+            }
+            m_buffers[i].reset(static_cast<char*>(buffer));
+        }
+        m_current = m_buffers[0].get();
+        if (options.background) {
+            m_thread = std::thread([this] { run(); });
+        }
+    }
+
+    // Submits the current buffer, and continues in the other one. With O_DIRECT, the last partial page is carried over.
+    void hand_over() {
+        const std::size_t tail = m_direct ? m_used % Alignment : 0;
+        const std::size_t size = m_used - tail;
+        char* full = m_current;
+        char* next = m_buffers[1] && m_current == m_buffers[0].get() ? m_buffers[1].get() : m_buffers[0].get();
+        submit(full, size);
+        std::memmove(next, full + size, tail);
+        m_current = next;
+        m_used = tail;
+        m_written += size;
+    }
+
+    // Without a background thread, the write is synchronous. Otherwise, this waits for the previous buffer to be written,
+    // so that it can be reused.
+    void submit(const char* buffer, std::size_t size) {
+        if (!m_thread.joinable()) {
+            if (const int error = write_out(buffer, size)) {
+                throw std::system_error(error, std::generic_category(), "write");
+            }
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [&] { return !m_pending; });
+            throw_if_failed();
+            m_pending = buffer;
+            m_pendingSize = size;
+        }
+        m_condition.notify_all();
+    }
+
+    void wait_idle() {
+        if (m_thread.joinable()) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [&] { return !m_pending; });
+            throw_if_failed();
+        }
+    }
+
+    void throw_if_failed() {
+        if (m_error != 0) {
+            throw std::system_error(std::exchange(m_error, 0), std::generic_category(), "write");
+        }
+    }
+
+    void stop() {
+        if (m_thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_condition.notify_all();
+            m_thread.join();
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_condition.wait(lock, [&] { return m_stopping || m_pending; });
+            if (!m_pending) {
+                return;
+            }
+            lock.unlock();
+            const int error = write_out(m_pending, m_pendingSize);
+            lock.lock();
+            if (error != 0) {
+                m_error = error;
+            }
+            m_pending = nullptr;
+            m_condition.notify_all();
+        }
+    }
+
+    // Returns 0 or an errno value
+    int write_out(const char* data, std::size_t size) {
+        if (m_stream) {
+            m_stream->write(data, static_cast<std::streamsize>(size));
+            return m_stream->good() ? 0 : EIO;
+        }
+        while (size > 0) {
+            const ssize_t n = ::write(m_fd, data, size);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno;
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+        }
+        return 0;
+    }
+
+    file_descriptor m_file;
+    int m_fd = -1;
+    std::ostream* m_stream = nullptr;
+    bool m_direct = false;
+    bool m_closed = false;
+    const std::size_t m_capacity;
+    buffer_ptr m_buffers[2];
+    char* m_current = nullptr;
+    std::size_t m_used = 0;
+    std::uint64_t m_written = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    const char* m_pending = nullptr;
+    std::size_t m_pendingSize = 0;
+    int m_error = 0;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
+
+template<typename T, typename = void>
+struct is_tuple_like : std::false_type {};
+template<typename T>
+struct is_tuple_like<T, std::void_t<decltype(std::tuple_size<T>::value)>> : std::true_type {};
+
+/**
+ * @brief Formatter for write_range() that writes one value per line, as text.
+ *
+ * Numbers are formatted with std::to_chars(), strings (anything convertible to std::string_view, or with data() and size()
+ * like QByteArray) are written as is, and tuples and pairs (like the rows of make_synchronized() and make_keyval())
+ * are written field by field, separated by @p separator.
+ */
+struct text_format {
+    char separator = '\t';
+    char terminator = '\n';
+
+    template<typename T>
+    void operator()(output_sink& sink, const T& value) const {
+        write_field(sink, value);
+        sink.put(terminator);
+    }
+
+private:
+    static constexpr std::size_t MaxNumberSize = 64;
+
+    template<typename T>
+    void write_field(output_sink& sink, const T& value) const {
+        if constexpr (std::is_same<T, bool>::value) {
+            sink.put(value ? '1' : '0');
+        } else if constexpr (std::is_same<T, char>::value) {
+            sink.put(value);
+        } else if constexpr (std::is_arithmetic<T>::value) {
+            char* out = sink.reserve(MaxNumberSize);
+            sink.commit(static_cast<std::size_t>(std::to_chars(out, out + MaxNumberSize, value).ptr - out));
+        } else if constexpr (std::is_convertible<const T&, std::string_view>::value) {
+            const std::string_view text = value;
+            sink.write(text.data(), text.size());
+        } else if constexpr (is_tuple_like<T>::value) {
+            write_fields(sink, value, std::make_index_sequence<std::tuple_size<T>::value>());
+        } else {
+            sink.write(value.data(), static_cast<std::size_t>(value.size()) * sizeof(*value.data()));
+        }
+    }
+
+    template<typename T, std::size_t...Is>
+    void write_fields(output_sink& sink, const T& value, std::index_sequence<Is...>) const {
+        ((Is == 0 ? void() : sink.put(separator), write_field(sink, std::get<Is>(value))), ...);
+    }
+};
+
+/**
+ * @brief Formatter for write_range() that writes the raw bytes of trivially copyable values.
+ *
+ * Tuples and pairs of trivially copyable values (like the rows of make_synchronized()) are written field by field, without padding.
+ * The output can be read back with make_records() when the values are records.
+ */
+struct binary_format {
+    template<typename T>
+    void operator()(output_sink& sink, const T& value) const {
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            sink.write(&value, sizeof(T));
+        } else if constexpr (is_tuple_like<T>::value) {
+            std::apply([&](const auto&...fields) { ((*this)(sink, fields), ...); }, value);
+        } else {
+            static_assert(sizeof(T) == 0, "binary_format requires trivially copyable values");
+        }
+    }
+};
+
+/**
+ * @brief This terminal writes every element of a range to an output_sink with a formatter, and returns the number of elements.
+ *
+ * The sink batches the output into large buffers, so each element costs a copy into memory rather than a call into
+ * a stream or the kernel. Call close() on the sink to write the last buffer and get the write errors.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * file_write_options options;
+ * options.directIo = true;
+ * output_sink sink("/data/totals.tsv", options);
+ * write_range(make_keyval(totals), sink);           // customer<TAB>total per line
+ * sink.close();
+ *
+ * output_sink ticks("/data/ticks.bin");
+ * write_range(make_reversible(buffer), ticks, binary_format());
+ * ticks.close();
+ * @endcode
+ */
+template<typename R, typename Format = text_format>
+std::size_t write_range(R&& range, output_sink& sink, Format format = Format()) {
+    std::size_t count = 0;
+    for (auto&& value : range) {
+        format(sink, value);
+        ++count;
+    }
+    return count;
+}
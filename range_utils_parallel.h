@@ -0,0 +1,528 @@
+#pragma once
+
+#include "range_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Type-erased unit of work scheduled on a work_stealing_pool.
+ *
+ * Tasks are never allocated by the pool itself: fork_join() keeps them on the stack of the forking thread,
+ * which is safe since the forking thread always waits for completion before returning.
+ */
+struct pool_task {
+    explicit pool_task(void (*execute)(pool_task*)) : m_execute(execute) {}
+
+    // The task may be destroyed by its owner as soon as it is marked as done, so m_execute must do that last
+    void run() { m_execute(this); }
+    bool done() const { return m_done.load(std::memory_order_acquire); }
+
+    void (*m_execute)(pool_task*);
+    std::atomic<bool> m_done{false};
+};
+
+template<typename Func>
+struct pool_task_impl : pool_task {
+    explicit pool_task_impl(Func& func) : pool_task(&execute_impl), m_func(func) {}
+
+    static void execute_impl(pool_task* task) {
+        auto* self = static_cast<pool_task_impl*>(task);
+        try { self->m_func(); } catch (...) { self->m_error = std::current_exception(); }
+        self->m_done.store(true, std::memory_order_release);
+    }
+
+    Func& m_func;
+    std::exception_ptr m_error;
+};
+
+/**
+ * @brief Chase-Lev work-stealing deque, as described in "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al., PPoPP 2013).
+ *
+ * The owner thread pushes and pops at the bottom end without any atomic read-modify-write in the common case,
+ * while thieves steal from the top end with a single CAS. The circular buffer grows on demand; retired buffers
+ * are kept alive until the deque is destroyed since thieves may still be reading from them.
+ */
+class chase_lev_deque {
+public:
+    explicit chase_lev_deque(std::size_t capacity = 256) { m_buffers.emplace_back(new ring(capacity)); m_ring.store(m_buffers.back().get(), std::memory_order_relaxed); }
+
+    chase_lev_deque(const chase_lev_deque&) = delete;
+    chase_lev_deque& operator=(const chase_lev_deque&) = delete;
+
+    // Owner only
+    void push(pool_task* task) {
+        const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = m_top.load(std::memory_order_acquire);
+        ring* r = m_ring.load(std::memory_order_relaxed);
+        if (b - t > static_cast<std::int64_t>(r->m_mask)) {
+            r = grow(r, b, t);
+        }
+        r->put(b, task);
+        // A release store rather than the paper's release fence and relaxed store: the same code, but visible to ThreadSanitizer
+        m_bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // Owner only
+    pool_task* pop() {
+        const std::int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        ring* r = m_ring.load(std::memory_order_relaxed);
+        // Release stores to m_bottom, here as in push(): a thief may read the bottom written by pop() rather than by push(),
+        // and since c++20 a relaxed store no longer extends the release sequence of the push(), so it wouldn't see the task
+        m_bottom.store(b, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = m_top.load(std::memory_order_relaxed);
+        if (t > b) {
+            m_bottom.store(b + 1, std::memory_order_release);
+            return nullptr;
+        }
+        pool_task* task = r->get(b);
+        if (t == b) {
+            // Last element: race against thieves for it
+            if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                task = nullptr;
+            }
+            m_bottom.store(b + 1, std::memory_order_release);
+        }
+        return task;
+    }
+
+    // Any thread
+    pool_task* steal() {
+        std::int64_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t b = m_bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        pool_task* task = m_ring.load(std::memory_order_acquire)->get(t);
+        if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return task;
+    }
+
+private:
+    struct ring {
+        explicit ring(std::size_t capacity) : m_mask(capacity - 1), m_slots(new std::atomic<pool_task*>[capacity]) {}
+
+        pool_task* get(std::int64_t i) const { return m_slots[static_cast<std::size_t>(i) & m_mask].load(std::memory_order_relaxed); }
+        void put(std::int64_t i, pool_task* task) { m_slots[static_cast<std::size_t>(i) & m_mask].store(task, std::memory_order_relaxed); }
+
+        std::size_t m_mask; // capacity is always a power of two
+        std::unique_ptr<std::atomic<pool_task*>[]> m_slots;
+    };
+
+    ring* grow(ring* old, std::int64_t b, std::int64_t t) {
+        m_buffers.emplace_back(new ring((old->m_mask + 1) * 2));
+        ring* r = m_buffers.back().get();
+        for (std::int64_t i = t; i < b; ++i) {
+            r->put(i, old->get(i));
+        }
+        m_ring.store(r, std::memory_order_release);
+        return r;
+    }
+
+    // Keep the top (thieves) and bottom (owner) indices on separate cache lines. Padding rather than alignas,
+    // since over-aligned new isn't available before c++17
+    std::atomic<std::int64_t> m_top{0};
+    char m_padding[64 - sizeof(std::atomic<std::int64_t>)];
+    std::atomic<std::int64_t> m_bottom{0};
+    std::atomic<ring*> m_ring{nullptr};
+    std::vector<std::unique_ptr<ring>> m_buffers; // owner only, see class comment
+};
+
+/**
+ * @brief A lightweight fork-join scheduler with one Chase-Lev deque per worker thread.
+ *
+ * Work is expressed as nested fork_join() calls: the second branch is pushed on the local deque where idle workers
+ * can steal it, while the forking thread runs the first branch inline and then either pops the second one back
+ * or helps executing other tasks until the thief is done. Calls made from outside the pool are injected
+ * into a shared queue and block until the whole computation completes.
+ *
+ * A single process-wide instance is available through shared(), which all the parallel range_utils helpers default to,
+ * so nested or concurrent parallel loops share the same threads instead of each spawning their own.
+ */
+class work_stealing_pool {
+public:
+    explicit work_stealing_pool(unsigned threadCount = std::thread::hardware_concurrency()) {
+        threadCount = std::max(threadCount, 1u);
+        m_deques.reserve(threadCount);
+        for (unsigned i = 0; i < threadCount; ++i) {
+            m_deques.emplace_back(new chase_lev_deque);
+        }
+        m_threads.reserve(threadCount);
+        for (unsigned i = 0; i < threadCount; ++i) {
+            m_threads.emplace_back([this, i] { worker_main(i); });
+        }
+    }
+
+    ~work_stealing_pool() {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stopping.store(true, std::memory_order_relaxed);
+        }
+        m_sleepCondition.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    work_stealing_pool(const work_stealing_pool&) = delete;
+    work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+    /**
+     * @brief Returns the process-wide pool, lazily created with one worker per hardware thread.
+     */
+    static work_stealing_pool& shared() { static work_stealing_pool pool; return pool; }
+
+    unsigned size() const { return static_cast<unsigned>(m_deques.size()); } // Not m_threads, which is still being filled when the first workers start
+
+    /**
+     * @brief Returns the index of the calling worker thread in [0, size()), or -1 if called from outside this pool.
+     */
+    int current_worker_index() const { const worker_context& ctx = current_context(); return ctx.m_pool == this ? static_cast<int>(ctx.m_index) : -1; }
+
+    /**
+     * @brief Runs @p func on a worker thread and waits for it. Runs inline when already called from one of this pool's workers.
+     */
+    template<typename Func>
+    void run(Func&& func) {
+        if (current_worker_index() >= 0) {
+            func();
+            return;
+        }
+        external_task<Func> task(func);
+        {
+            std::lock_guard<std::mutex> lock(m_injectMutex);
+            m_injected.push_back(&task);
+            m_injectedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        wake_one();
+        task.wait();
+        if (task.m_error) {
+            std::rethrow_exception(task.m_error);
+        }
+    }
+
+    /**
+     * @brief Runs @p left and @p right potentially in parallel and returns when both are done.
+     *
+     * Exceptions thrown by either branch are propagated to the caller once both branches have completed.
+     */
+    template<typename Left, typename Right>
+    void fork_join(Left&& left, Right&& right) {
+        const int index = current_worker_index();
+        if (index < 0) {
+            run([&] { fork_join(left, right); });
+            return;
+        }
+        chase_lev_deque& deque = *m_deques[static_cast<unsigned>(index)];
+        pool_task_impl<Right> task(right);
+        deque.push(&task);
+        wake_one();
+
+        std::exception_ptr error;
+        try { left(); } catch (...) { error = std::current_exception(); }
+
+        while (!task.done()) {
+            if (pool_task* next = deque.pop()) {
+                next->run(); // Either our own task, or an older one from an outer fork that we may just as well run now
+            } else if (pool_task* other = find_work(static_cast<unsigned>(index))) {
+                other->run();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if (task.m_error) {
+            std::rethrow_exception(task.m_error);
+        }
+    }
+
+    /**
+     * @brief Calls @p func(first, last) over [first, last) recursively split into chunks of at most @p grain indices.
+     *
+     * A @p grain of 0 picks a chunk size giving each worker a few chunks to balance the load.
+     */
+    template<typename Index, typename Func>
+    void parallel_for(Index first, Index last, Index grain, Func&& func) {
+        if (!(first < last)) {
+            return;
+        }
+        if (grain == Index(0)) {
+            grain = default_grain<Index>(static_cast<std::size_t>(last - first));
+        }
+        run([&] { parallel_for_impl(first, last, grain, func); });
+    }
+
+    template<typename Index>
+    Index default_grain(std::size_t count) const { return static_cast<Index>(std::max<std::size_t>(count / (size() * 8), 1)); }
+
+private:
+    struct worker_context {
+        const work_stealing_pool* m_pool = nullptr;
+        unsigned m_index = 0;
+        std::uint32_t m_seed = 0x9e3779b9u;
+    };
+
+    static worker_context& current_context() { static thread_local worker_context ctx; return ctx; }
+
+    template<typename Func>
+    struct external_task : pool_task {
+        explicit external_task(Func& func) : pool_task(&execute_impl), m_func(func) {}
+
+        static void execute_impl(pool_task* task) {
+            auto* self = static_cast<external_task*>(task);
+            try { self->m_func(); } catch (...) { self->m_error = std::current_exception(); }
+            std::lock_guard<std::mutex> lock(self->m_mutex);
+            self->m_finished = true;
+            self->m_condition.notify_one(); // Notify under the lock, the task lives on the waiter's stack
+        }
+
+        void wait() { std::unique_lock<std::mutex> lock(m_mutex); m_condition.wait(lock, [this] { return m_finished; }); }
+
+        Func& m_func;
+        std::exception_ptr m_error;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_finished = false;
+    };
+
+    template<typename Index, typename Func>
+    void parallel_for_impl(Index first, Index last, Index grain, Func& func) {
+        if (last - first > grain) {
+            const Index mid = first + (last - first) / 2;
+            fork_join([&] { parallel_for_impl(first, mid, grain, func); }, [&] { parallel_for_impl(mid, last, grain, func); });
+        } else {
+            func(first, last);
+        }
+    }
+
+    pool_task* find_work(unsigned index) {
+        if (pool_task* task = m_deques[index]->pop()) {
+            return task;
+        }
+        if (m_injectedCount.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(m_injectMutex);
+            if (!m_injected.empty()) {
+                pool_task* task = m_injected.front();
+                m_injected.pop_front();
+                m_injectedCount.fetch_sub(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        // Start from a pseudo-random victim so that thieves don't all contend on the same deque
+        worker_context& ctx = current_context();
+        ctx.m_seed ^= ctx.m_seed << 13; ctx.m_seed ^= ctx.m_seed >> 17; ctx.m_seed ^= ctx.m_seed << 5;
+        const unsigned count = size();
+        const unsigned start = ctx.m_seed % count;
+        for (unsigned i = 0; i < count; ++i) {
+            const unsigned victim = (start + i) % count;
+            if (victim == index) {
+                continue;
+            }
+            if (pool_task* task = m_deques[victim]->steal()) {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    void wake_one() {
+        // Pairs with the increment of m_sleepers in worker_main(): either the sleeper sees the new task in its last scan,
+        // or we see it registered here and notify it under the lock, so wake-ups can't be lost
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleepers.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_sleepCondition.notify_one();
+        }
+    }
+
+    void worker_main(unsigned index) {
+        worker_context& ctx = current_context();
+        ctx.m_pool = this;
+        ctx.m_index = index;
+        ctx.m_seed += index * 0x85ebca6bu;
+
+        unsigned idleRounds = 0;
+        while (!m_stopping.load(std::memory_order_relaxed)) {
+            if (pool_task* task = find_work(index)) {
+                task->run();
+                idleRounds = 0;
+                continue;
+            }
+            if (++idleRounds < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            idleRounds = 0;
+
+            pool_task* task = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(m_sleepMutex);
+                m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+                if (!m_stopping.load(std::memory_order_relaxed)) {
+                    task = find_work(index);
+                    if (!task) {
+                        m_sleepCondition.wait(lock);
+                    }
+                }
+                m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+            }
+            if (task) {
+                task->run();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<chase_lev_deque>> m_deques;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_injectMutex;
+    std::deque<pool_task*> m_injected;
+    std::atomic<std::size_t> m_injectedCount{0};
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCondition;
+    std::atomic<unsigned> m_sleepers{0};
+    std::atomic<bool> m_stopping{false};
+};
+
+/**
+ * @brief This helper runs @p func(first, last) over chunks of the [first, last) index range on the shared work-stealing pool.
+ *
+ * The range is recursively split in halves until chunks are at most @p grain indices long (0 picks a default),
+ * and the halves are distributed between the pool workers by work-stealing.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * QVector<float> values = ...;
+ * parallel_for(0, values.size(), 4096, [&](int first, int last) {
+ *     for (float& value : make_mutable_reversible(...)) { ... } // or any sequential loop over [first, last)
+ * });
+ * @endcode
+ */
+template<typename Index, typename Func>
+void parallel_for(Index first, Index last, Index grain, Func&& func, work_stealing_pool& pool = work_stealing_pool::shared()) { pool.parallel_for(first, last, grain, std::forward<Func>(func)); }
+
+/**
+ * @brief This helper calls @p func on every element of the random-access iterator range [first, last) on the shared work-stealing pool.
+ *
+ * Elements are processed in chunks of @p grain consecutive elements (0 picks a default), so there is no ordering
+ * guarantee between chunks, but each chunk is visited in order.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * std::vector<Particle> particles = ...;
+ * parallel_for_each(particles.begin(), particles.end(), [](Particle& p) { p.integrate(dt); });
+ * @endcode
+ */
+template<typename RandomIt, typename Func>
+void parallel_for_each(RandomIt first, RandomIt last, Func&& func, std::size_t grain = 0, work_stealing_pool& pool = work_stealing_pool::shared()) {
+    using difference_type = typename std::iterator_traits<RandomIt>::difference_type;
+    pool.parallel_for(difference_type(0), last - first, static_cast<difference_type>(grain), [&](difference_type begin, difference_type end) {
+        for (RandomIt it = first + begin, itEnd = first + end; it != itEnd; ++it) {
+            func(*it);
+        }
+    });
+}
+
+template<typename View, typename ChunkFunc>
+void parallel_for_each_chunk_impl(work_stealing_pool& pool, View&& view, std::size_t grain, ChunkFunc& func) {
+    const std::size_t size = view.size_hint();
+    if (size <= grain) {
+        func(view);
+        return;
+    }
+    auto halves = view.split();
+    // A view that can't be split further returns itself and an empty half, so stop rather than splitting it again forever
+    const std::size_t firstSize = halves.first.size_hint();
+    const std::size_t secondSize = halves.second.size_hint();
+    if (firstSize == 0 || secondSize == 0 || firstSize == size || secondSize == size) {
+        func(view);
+        return;
+    }
+    pool.fork_join([&] { parallel_for_each_chunk_impl(pool, halves.first, grain, func); }, [&] { parallel_for_each_chunk_impl(pool, halves.second, grain, func); });
+}
+
+/**
+ * @brief This helper recursively splits any splittable view on the shared work-stealing pool, and calls @p func on each piece.
+ *
+ * This is the building block for parallel_for_each() and the other parallel algorithms: pieces hold at most @p grain elements
+ * (0 picks a default) and are ranges themselves, so @p func typically iterates them sequentially, which allows keeping
+ * per-piece state (like a local accumulator) out of the inner loop. The pieces don't all have the same type,
+ * so @p func must be generic.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * std::atomic<long> total{0};
+ * parallel_for_each_chunk(make_reversible(values), [&](auto&& chunk) {
+ *     long sum = 0;
+ *     for (int value : chunk)
+ *         sum += value;
+ *     total += sum;
+ * });
+ * @endcode
+ */
+template<typename View, typename ChunkFunc>
+void parallel_for_each_chunk(View&& view, ChunkFunc&& func, std::size_t grain = 0, work_stealing_pool& pool = work_stealing_pool::shared()) {
+    static_assert(has_split<std::decay_t<View>>::value,
+                  "parallel_for_each: the view doesn't implement the split protocol (see range_utils.h), buffer single-pass ranges with make_buffered() first");
+    const std::size_t size = view.size_hint();
+    if (grain == 0) {
+        grain = pool.default_grain<std::size_t>(size);
+    }
+    if (size <= grain) {
+        func(view);
+        return;
+    }
+    pool.run([&] { parallel_for_each_chunk_impl(pool, view, grain, func); });
+}
+
+/**
+ * @brief This helper calls @p func on every element of any splittable view on the shared work-stealing pool.
+ *
+ * The view is recursively split in halves through the split protocol (see range_slice in range_utils.h)
+ * until the pieces hold at most @p grain elements (0 picks a default), and the pieces are then iterated sequentially.
+ * This works the same for all the range_utils adapters and their compositions, so there's no parallel version
+ * to write for each adapter.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * const QVector<float> xs = ..., ys = ...;
+ * std::atomic<int> inside{0};
+ * parallel_for_each(make_synchronized(xs, ys), [&](auto&& point) {
+ *     auto [x, y] = point;
+ *     if (x * x + y * y < 1.f)
+ *         ++inside;
+ * });
+ *
+ * QVector<int> values = ...;
+ * parallel_for_each(make_mutable_reversible(values), [](int& value) { value = -value; });
+ * @endcode
+ */
+template<typename View, typename Func>
+void parallel_for_each(View&& view, Func&& func, std::size_t grain = 0, work_stealing_pool& pool = work_stealing_pool::shared()) {
+    parallel_for_each_chunk(view, [&func](auto&& chunk) {
+        for (auto&& value : chunk) {
+            func(std::forward<decltype(value)>(value));
+        }
+    }, grain, pool);
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include "range_utils_queue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct pipeline_options {
+    std::size_t batchSize = 256;  // Elements handed over between stages at once
+    std::size_t capacity = 8192;  // Elements buffered between two stages before the upstream one blocks
+};
+
+// Computes the element types flowing between the stages: T0 is the source value type, T(k+1) is the result of stage k on Tk,
+// and rings is the tuple of std::unique_ptr<spsc_ring<Tk>> connecting them, the last one feeding the range-for loop
+template<typename T, typename...Stages>
+struct pipeline_types {
+    using rings = std::tuple<std::unique_ptr<spsc_ring<T>>>;
+};
+template<typename T, typename Stage, typename...Stages>
+struct pipeline_types<T, Stage, Stages...> {
+    using next = std::decay_t<decltype(std::declval<Stage&>()(std::declval<T&&>()))>;
+    using rings = decltype(std::tuple_cat(std::declval<std::tuple<std::unique_ptr<spsc_ring<T>>>>(), std::declval<typename pipeline_types<next, Stages...>::rings>()));
+};
+
+template<typename C, typename...Stages>
+struct pipelined_range_iterator {
+    using NoRefC = typename std::remove_reference<C>::type;
+    using source_type = std::decay_t<decltype(*std::declval<const NoRefC&>().begin())>;
+    using rings = typename pipeline_types<source_type, Stages...>::rings;
+    using value_type = typename std::tuple_element<sizeof...(Stages), rings>::type::element_type::value_type;
+
+private:
+    struct state;
+    struct pipeline;
+
+public:
+    pipelined_range_iterator(C&& container, pipeline_options options, Stages... stages)
+        : m_pipeline(new pipeline(std::forward<C>(container), options, std::move(stages)...)) {}
+
+    /**
+     * @brief This is a single-pass input iterator over the output of the last stage
+     */
+    struct iterator {
+        value_type& operator*() const { return m_state->m_buffer[m_state->m_index]; }
+        iterator& operator++() { if (++m_state->m_index == m_state->m_buffer.size()) m_state->refill(); return *this; }
+
+        // There is only ever one position in the stream, so only the end state matters
+        friend bool operator!=(const iterator& lhs, const iterator& rhs) { return lhs.at_end() != rhs.at_end(); }
+        friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.at_end() == rhs.at_end(); }
+        bool at_end() const { return !m_state || m_state->m_done; }
+
+        state* m_state;
+    };
+
+    iterator begin() {
+        if (!m_pipeline->m_state) {
+            m_pipeline->m_state.reset(new state(*m_pipeline));
+            m_pipeline->m_state->refill();
+        }
+        return {m_pipeline->m_state.get()};
+    }
+    iterator end() { return {nullptr}; }
+
+private:
+    struct state {
+        explicit state(pipeline& owner) : m_pipeline(owner) {
+            create_rings(std::make_index_sequence<sizeof...(Stages) + 1>());
+            m_buffer.reserve(m_pipeline.m_options.batchSize);
+            m_threads.reserve(sizeof...(Stages) + 1);
+            try {
+                m_threads.emplace_back([this] { run_source(); });
+                start_stages(std::make_index_sequence<sizeof...(Stages)>());
+            } catch (...) {
+                // A thread failed to start: the destructor won't run, and the threads already started use this state
+                stop();
+                throw;
+            }
+        }
+
+        ~state() { stop(); }
+
+        void stop() {
+            m_cancelled.store(true, std::memory_order_relaxed);
+            for (auto& thread : m_threads) {
+                thread.join();
+            }
+        }
+
+        template<std::size_t...Is>
+        void create_rings(std::index_sequence<Is...>) {
+            (void) std::initializer_list<int>{ ((void)std::get<Is>(m_rings).reset(new typename std::tuple_element<Is, rings>::type::element_type(m_pipeline.m_options.capacity)), 0)... };
+        }
+
+        template<std::size_t...Is>
+        void start_stages(std::index_sequence<Is...>) {
+            (void) std::initializer_list<int>{ ((void)m_threads.emplace_back([this] { run_stage<Is>(); }), 0)... };
+        }
+
+        // Pushes the whole batch, waiting while the downstream ring is full (backpressure). Returns false if the pipeline was cancelled.
+        template<typename T>
+        bool push_batch(spsc_ring<T>& ring, std::vector<T>& batch) {
+            spin_backoff backoff;
+            for (std::size_t pushed = 0; pushed < batch.size();) {
+                const std::size_t count = ring.try_push_bulk(std::make_move_iterator(batch.begin() + pushed), batch.size() - pushed);
+                if (count == 0) {
+                    if (m_cancelled.load(std::memory_order_relaxed)) {
+                        return false;
+                    }
+                    backoff.pause();
+                } else {
+                    pushed += count;
+                    backoff.reset();
+                }
+            }
+            batch.clear();
+            return true;
+        }
+
+        // Pops the next batch, waiting while the upstream ring is empty. Returns false once the upstream stage is done or the pipeline was cancelled.
+        template<typename T>
+        bool pop_batch(spsc_ring<T>& ring, std::vector<T>& batch) {
+            batch.clear();
+            auto out = std::back_inserter(batch);
+            spin_backoff backoff;
+            while (ring.try_pop_bulk(out, m_pipeline.m_options.batchSize) == 0) {
+                if (ring.is_closed()) {
+                    // The producer closes the ring after its last push, so one last attempt is enough to drain it
+                    return ring.try_pop_bulk(out, m_pipeline.m_options.batchSize) > 0;
+                }
+                if (m_cancelled.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+                backoff.pause();
+            }
+            return true;
+        }
+
+        void fail() {
+            std::lock_guard<std::mutex> lock(m_errorMutex);
+            if (!m_error) {
+                m_error = std::current_exception();
+            }
+            m_cancelled.store(true, std::memory_order_relaxed);
+        }
+
+        void run_source() {
+            auto& ring = *std::get<0>(m_rings);
+            try {
+                std::vector<source_type> batch;
+                batch.reserve(m_pipeline.m_options.batchSize);
+                for (auto&& value : m_pipeline.m_container.cget()) {
+                    batch.push_back(std::forward<decltype(value)>(value));
+                    if (batch.size() == m_pipeline.m_options.batchSize && !push_batch(ring, batch)) {
+                        break;
+                    }
+                }
+                push_batch(ring, batch);
+            } catch (...) {
+                fail();
+            }
+            ring.close();
+        }
+
+        template<std::size_t I>
+        void run_stage() {
+            auto& in = *std::get<I>(m_rings);
+            auto& out = *std::get<I + 1>(m_rings);
+            auto& stage = std::get<I>(m_pipeline.m_stages);
+            try {
+                std::vector<typename std::decay_t<decltype(in)>::value_type> inBatch;
+                std::vector<typename std::decay_t<decltype(out)>::value_type> outBatch;
+                inBatch.reserve(m_pipeline.m_options.batchSize);
+                outBatch.reserve(m_pipeline.m_options.batchSize);
+                while (pop_batch(in, inBatch)) {
+                    for (auto& value : inBatch) {
+                        outBatch.push_back(stage(std::move(value)));
+                    }
+                    if (!push_batch(out, outBatch)) {
+                        break;
+                    }
+                }
+            } catch (...) {
+                fail();
+            }
+            out.close();
+        }
+
+        void refill() {
+            m_index = 0;
+            if (!pop_batch(*std::get<sizeof...(Stages)>(m_rings), m_buffer)) {
+                m_done = true;
+                std::lock_guard<std::mutex> lock(m_errorMutex);
+                if (m_error) {
+                    std::rethrow_exception(m_error);
+                }
+            }
+        }
+
+        pipeline& m_pipeline;
+        rings m_rings;
+        std::vector<value_type> m_buffer;
+        std::size_t m_index = 0;
+        bool m_done = false;
+        std::atomic<bool> m_cancelled{false};
+        std::mutex m_errorMutex;
+        std::exception_ptr m_error;
+        std::vector<std::thread> m_threads;
+    };
+
+    // Everything the stage threads use is on the heap, so that the range can be moved (or returned) while they are running
+    struct pipeline {
+        pipeline(C&& container, pipeline_options options, Stages... stages) : m_container(std::forward<C>(container)), m_stages(std::move(stages)...), m_options(options) {}
+
+        // Lvalues are referenced and rvalues are moved in, see range_storage
+        range_storage<C> m_container;
+        std::tuple<Stages...> m_stages;
+        pipeline_options m_options;
+        std::unique_ptr<state> m_state; // Declared last so that the threads are joined before anything they use gets destroyed
+    };
+
+    std::unique_ptr<pipeline> m_pipeline;
+};
+
+/**
+ * @brief This helper runs each stage of a processing chain on its own thread, connected by bounded SPSC ring buffers.
+ *
+ * The source range is iterated on a dedicated thread, and each stage is a callable applied to every element
+ * produced by the previous one, on its own thread. The range-for loop body then runs on the calling thread
+ * as the final stage. Elements are handed over in batches of pipeline_options::batchSize to amortize synchronization,
+ * and a stage blocks when the ring to the next one is full, so a lagging stage slows its upstream down
+ * instead of growing unbounded buffers.
+ *
+ * Exceptions thrown by the source or any stage stop the pipeline, and are rethrown from the range-for loop.
+ * Breaking out of the loop cancels the pipeline and joins the stage threads. If a thread can't be started, begin()
+ * throws std::system_error, once the threads already started are joined.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * QHash<QString, double> totals;
+ * for (const Record& record : make_pipelined(logLines, parse, enrich)) {
+ *     totals[record.customer] += record.amount; // aggregate on the calling thread
+ * }
+ * @endcode
+ */
+template<typename C, typename...Stages>
+auto make_pipelined(C&& container, Stages... stages) { return pipelined_range_iterator<C, Stages...>(std::forward<C>(container), pipeline_options(), std::move(stages)...); }
+
+/**
+ * @brief This overload allows tuning the batch size and the buffering between stages.
+ */
+template<typename C, typename...Stages>
+auto make_pipelined(pipeline_options options, C&& container, Stages... stages) { return pipelined_range_iterator<C, Stages...>(std::forward<C>(container), options, std::move(stages)...); }
@@ -0,0 +1,373 @@
+#pragma once
+
+#include "range_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Progressive back-off for lock-free waits: busy-spin first, then yield, then sleep for short periods.
+ */
+struct spin_backoff {
+    void pause() {
+        if (m_count < 16) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else if (m_count < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        ++m_count;
+    }
+    void reset() { m_count = 0; }
+
+    unsigned m_count = 0;
+};
+
+/**
+ * @brief Bounded lock-free multi-producer multi-consumer queue (Dmitry Vyukov's ring buffer with per-cell sequence numbers).
+ *
+ * Producers and consumers each claim cells with a single CAS on their own index, and the bulk operations
+ * claim a whole run of consecutive cells with one CAS, which amortizes the atomic operations over the batch.
+ *
+ * close() marks the end of the stream: further pushes fail, and consumers stop once the queue is drained.
+ * It must be called after all the producers are done pushing, typically by the last one.
+ *
+ * A claimed cell must be published, or the consumers wait for it forever, so elements are moved in and out of the
+ * cells without throwing, and elements that may throw while being converted to T are pushed one at a time.
+ */
+template<typename T>
+class mpmc_queue {
+    static_assert(std::is_nothrow_move_constructible<T>::value, "mpmc_queue: the elements must be nothrow move constructible");
+
+public:
+    using value_type = T;
+
+    explicit mpmc_queue(std::size_t capacity) : m_mask(round_up_pow2(capacity) - 1), m_cells(new cell[m_mask + 1]) {
+        for (std::size_t i = 0; i <= m_mask; ++i) {
+            m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~mpmc_queue() {
+        for (std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed), end = m_enqueuePos.load(std::memory_order_relaxed); pos != end; ++pos) {
+            m_cells[pos & m_mask].value()->~T();
+        }
+    }
+
+    mpmc_queue(const mpmc_queue&) = delete;
+    mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+    std::size_t capacity() const { return m_mask + 1; }
+
+    bool try_push(T value) { return try_push_bulk(std::make_move_iterator(&value), 1) == 1; }
+
+    /**
+     * @brief Pushes @p value, waiting for a free cell if the queue is full. Returns false if the queue was closed.
+     */
+    bool push(T value) {
+        spin_backoff backoff;
+        while (!is_closed()) {
+            if (try_push_bulk(std::make_move_iterator(&value), 1) == 1) {
+                return true;
+            }
+            backoff.pause();
+        }
+        return false;
+    }
+
+    /**
+     * @brief Pushes up to @p count elements from @p first with a single claim, and returns how many were pushed.
+     *
+     * If constructing a T from *first may throw, each element is constructed before claiming its own cell instead.
+     */
+    template<typename InputIt>
+    std::size_t try_push_bulk(InputIt first, std::size_t count) {
+        return push_bulk(first, count, std::is_nothrow_constructible<T, decltype(*first)>());
+    }
+
+    bool try_pop(T& value) {
+        T* out = &value;
+        return try_pop_bulk(out, 1) == 1;
+    }
+
+    /**
+     * @brief Pops up to @p maxCount elements with a single claim into @p out, and returns how many were popped.
+     */
+    template<typename OutputIt>
+    std::size_t try_pop_bulk(OutputIt& out, std::size_t maxCount) {
+        std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        std::size_t claimed = 0;
+        for (;;) {
+            claimed = 0;
+            while (claimed < maxCount && m_cells[(pos + claimed) & m_mask].m_sequence.load(std::memory_order_acquire) == pos + claimed + 1) {
+                ++claimed;
+            }
+            if (claimed == 0) {
+                const std::size_t sequence = m_cells[pos & m_mask].m_sequence.load(std::memory_order_acquire);
+                if (static_cast<std::ptrdiff_t>(sequence - (pos + 1)) < 0) {
+                    return 0; // Empty
+                }
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (m_dequeuePos.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (std::size_t i = 0; i < claimed; ++i) {
+            cell& c = m_cells[(pos + i) & m_mask];
+            *out = std::move(*c.value());
+            ++out;
+            c.value()->~T();
+            c.m_sequence.store(pos + i + m_mask + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    void close() { m_closed.store(true, std::memory_order_release); }
+    bool is_closed() const { return m_closed.load(std::memory_order_acquire); }
+
+private:
+    template<typename InputIt>
+    std::size_t push_bulk(InputIt first, std::size_t count, std::true_type /* nothrow */) {
+        if (is_closed()) {
+            return 0;
+        }
+        std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        std::size_t claimed = 0;
+        for (;;) {
+            claimed = 0;
+            while (claimed < count && m_cells[(pos + claimed) & m_mask].m_sequence.load(std::memory_order_acquire) == pos + claimed) {
+                ++claimed;
+            }
+            if (claimed == 0) {
+                const std::size_t sequence = m_cells[pos & m_mask].m_sequence.load(std::memory_order_acquire);
+                if (static_cast<std::ptrdiff_t>(sequence - pos) < 0) {
+                    return 0; // Full
+                }
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (std::size_t i = 0; i < claimed; ++i, ++first) {
+            cell& c = m_cells[(pos + i) & m_mask];
+            new (c.value()) T(*first);
+            c.m_sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    template<typename InputIt>
+    std::size_t push_bulk(InputIt first, std::size_t count, std::false_type /* nothrow */) {
+        std::size_t pushed = 0;
+        for (; pushed < count; ++pushed, ++first) {
+            T value(*first);
+            if (push_bulk(std::make_move_iterator(&value), 1, std::true_type()) == 0) {
+                break;
+            }
+        }
+        return pushed;
+    }
+
+    struct cell {
+        T* value() { return reinterpret_cast<T*>(&m_storage); }
+
+        std::atomic<std::size_t> m_sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage;
+    };
+
+    static std::size_t round_up_pow2(std::size_t n) { std::size_t p = 2; while (p < n) p *= 2; return p; }
+
+    const std::size_t m_mask;
+    const std::unique_ptr<cell[]> m_cells;
+    // Keep producers and consumers indices on separate cache lines. Padding rather than alignas,
+    // since over-aligned new isn't available before c++17
+    char m_padding0[64];
+    std::atomic<std::size_t> m_enqueuePos{0};
+    char m_padding1[64 - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> m_dequeuePos{0};
+    char m_padding2[64 - sizeof(std::atomic<std::size_t>)];
+    std::atomic<bool> m_closed{false};
+};
+
+/**
+ * @brief Bounded lock-free single-producer single-consumer ring buffer.
+ *
+ * Each side only writes its own index and caches the other side's one, so the shared cache lines are only touched
+ * when the cached value runs out. Bulk operations publish a whole batch with a single release store.
+ *
+ * close() must be called by the producer after its last push; the consumer then stops once the ring is drained.
+ */
+template<typename T>
+class spsc_ring {
+public:
+    using value_type = T;
+
+    explicit spsc_ring(std::size_t capacity) : m_mask(round_up_pow2(capacity) - 1), m_slots(new storage[m_mask + 1]) {}
+
+    ~spsc_ring() {
+        for (std::size_t pos = m_head.load(std::memory_order_relaxed), end = m_tail.load(std::memory_order_relaxed); pos != end; ++pos) {
+            slot(pos)->~T();
+        }
+    }
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    std::size_t capacity() const { return m_mask + 1; }
+
+    /**
+     * @brief Pushes up to @p count elements from @p first, and returns how many fit in the ring. Producer only.
+     */
+    template<typename InputIt>
+    std::size_t try_push_bulk(InputIt first, std::size_t count) {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (capacity() - (tail - m_cachedHead) < count) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+        }
+        const std::size_t pushed = std::min(count, capacity() - (tail - m_cachedHead));
+        std::size_t i = 0;
+        try {
+            for (; i < pushed; ++i, ++first) {
+                new (slot(tail + i)) T(*first);
+            }
+        } catch (...) {
+            m_tail.store(tail + i, std::memory_order_release); // Publishes the elements constructed before the exception
+            throw;
+        }
+        m_tail.store(tail + pushed, std::memory_order_release);
+        return pushed;
+    }
+
+    /**
+     * @brief Pops up to @p maxCount elements into @p out, and returns how many were popped. Consumer only.
+     */
+    template<typename OutputIt>
+    std::size_t try_pop_bulk(OutputIt& out, std::size_t maxCount) {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (m_cachedTail - head < maxCount) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+        }
+        const std::size_t popped = std::min(maxCount, m_cachedTail - head);
+        for (std::size_t i = 0; i < popped; ++i) {
+            T* value = slot(head + i);
+            *out = std::move(*value);
+            ++out;
+            value->~T();
+        }
+        m_head.store(head + popped, std::memory_order_release);
+        return popped;
+    }
+
+    void close() { m_closed.store(true, std::memory_order_release); }
+    bool is_closed() const { return m_closed.load(std::memory_order_acquire); }
+
+private:
+    using storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    T* slot(std::size_t pos) { return reinterpret_cast<T*>(&m_slots[pos & m_mask]); }
+    static std::size_t round_up_pow2(std::size_t n) { std::size_t p = 2; while (p < n) p *= 2; return p; }
+
+    const std::size_t m_mask;
+    const std::unique_ptr<storage[]> m_slots;
+    std::atomic<bool> m_closed{false};
+    // Producer and consumer cache lines, see mpmc_queue for the padding
+    char m_padding0[64];
+    std::atomic<std::size_t> m_tail{0};
+    std::size_t m_cachedHead = 0;
+    char m_padding1[64 - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+    std::atomic<std::size_t> m_head{0};
+    std::size_t m_cachedTail = 0;
+    char m_padding2[64 - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+};
+
+template<typename T>
+struct consuming_range_iterator {
+    // A batch size of 0 would never pop anything, so it pops one element at a time instead
+    consuming_range_iterator(mpmc_queue<T>& queue, std::size_t batchSize) : m_queue(&queue), m_batchSize(std::max<std::size_t>(batchSize, 1)) { m_buffer.reserve(m_batchSize); }
+
+    /**
+     * @brief This is a single-pass input iterator over the local batch, refilled from the queue when exhausted
+     */
+    struct iterator {
+        T& operator*() const { return m_range->m_buffer[m_range->m_index]; }
+        iterator& operator++() { if (++m_range->m_index == m_range->m_buffer.size()) m_range->refill(); return *this; }
+
+        // There is only ever one position in the stream, so only the end state matters
+        friend bool operator!=(const iterator& lhs, const iterator& rhs) { return lhs.at_end() != rhs.at_end(); }
+        friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.at_end() == rhs.at_end(); }
+        bool at_end() const { return !m_range || m_range->m_done; }
+
+        consuming_range_iterator* m_range;
+    };
+
+    iterator begin() { if (m_buffer.empty() && !m_done) refill(); return {this}; }
+    iterator end() { return {nullptr}; }
+
+private:
+    void refill() {
+        m_buffer.clear();
+        m_index = 0;
+        auto out = std::back_inserter(m_buffer);
+        spin_backoff backoff;
+        while (m_queue->try_pop_bulk(out, m_batchSize) == 0) {
+            if (m_queue->is_closed()) {
+                // Pushes are complete before close(), so one last attempt is enough to drain the queue
+                if (m_queue->try_pop_bulk(out, m_batchSize) == 0) {
+                    m_done = true;
+                }
+                return;
+            }
+            backoff.pause();
+        }
+    }
+
+    mpmc_queue<T>* m_queue;
+    std::size_t m_batchSize;
+    std::vector<T> m_buffer;
+    std::size_t m_index = 0;
+    bool m_done = false;
+};
+
+/**
+ * @brief This helper drains an mpmc_queue within a range-for loop, until the queue is closed and empty.
+ *
+ * Elements are dequeued in batches of up to @p batchSize with a single claim on the queue, then handed one by one
+ * to the loop body from a local buffer, which amortizes the atomic operations over the batch. The loop waits
+ * (spinning, then yielding, then sleeping) while the queue is empty but not closed.
+ *
+ * Several consumer threads can each drain the same queue with their own range.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * mpmc_queue<Message> queue(4096);
+ *
+ * // producer threads
+ * queue.push(message);
+ * ...
+ * queue.close(); // once all producers are done
+ *
+ * // consumer threads
+ * for (Message& message : make_consuming(queue)) {
+ *     handle(std::move(message));
+ * }
+ * @endcode
+ */
+template<typename T>
+auto make_consuming(mpmc_queue<T>& queue, std::size_t batchSize = 64) { return consuming_range_iterator<T>(queue, batchSize); }
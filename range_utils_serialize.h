@@ -0,0 +1,336 @@
+#pragma once
+
+#include "range_utils_output.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Binary serialization format
+//
+// - Arithmetic and enum values are written as their little-endian bytes.
+// - Containers are prefixed with their element count as a 64-bit integer. When the elements are stored contiguously
+//   and are trivially copyable, the count is followed by zero padding up to the alignment of the element type
+//   (relative to the start of the stream), then by all the elements in a single block.
+//   Such blocks can be read back with a single memcpy(), or viewed in place with read_view().
+//   Other containers are followed by their elements, each one serialized recursively.
+// - Maps are written as their element count followed by each key and value.
+// - Tuples and pairs are written field by field.
+// - Other trivially copyable types (like plain structs) are written as their raw bytes, so they must have the same layout
+//   on the reading side.
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define RANGE_UTILS_BIG_ENDIAN 1
+#endif
+
+template<typename T, typename = void>
+struct is_map_like : std::false_type {};
+template<typename T>
+struct is_map_like<T, std::void_t<typename T::key_type, typename T::mapped_type>> : std::true_type {};
+
+// QMap and QHash iterate over values only, and expose the pairs through keyValueBegin()/keyValueEnd() (see make_keyval())
+template<typename T, typename = void>
+struct has_key_value_range : std::false_type {};
+template<typename T>
+struct has_key_value_range<T, std::void_t<decltype(std::declval<const T&>().keyValueBegin())>> : std::true_type {};
+
+template<typename T, typename = void>
+struct has_key_value_insert : std::false_type {};
+template<typename T>
+struct has_key_value_insert<T, std::void_t<decltype(std::declval<T&>().insert(std::declval<typename T::key_type>(), std::declval<typename T::mapped_type>()))>> : std::true_type {};
+
+template<typename T, typename = void>
+struct is_sequence_like : std::false_type {};
+template<typename T>
+struct is_sequence_like<T, std::void_t<typename T::value_type, decltype(std::declval<const T&>().begin()), decltype(std::declval<const T&>().size())>> : std::true_type {};
+
+// Contiguous containers without resize(), like std::array, are read back into their fixed size
+template<typename T, typename = void>
+struct is_resizable : std::false_type {};
+template<typename T>
+struct is_resizable<T, std::void_t<decltype(std::declval<T&>().resize(std::declval<T&>().size()))>> : std::true_type {};
+
+// Same for the other containers without clear(), like std::array of non-trivially copyable elements
+template<typename T, typename = void>
+struct is_clearable : std::false_type {};
+template<typename T>
+struct is_clearable<T, std::void_t<decltype(std::declval<T&>().clear())>> : std::true_type {};
+
+template<typename T, typename = void>
+struct is_contiguous_block : std::false_type {};
+template<typename T>
+struct is_contiguous_block<T, std::void_t<decltype(std::declval<const T&>().data()), decltype(std::declval<const T&>().size())>>
+    : std::integral_constant<bool, std::is_trivially_copyable<typename T::value_type>::value
+#ifdef RANGE_UTILS_BIG_ENDIAN
+                                   && !std::is_arithmetic<typename T::value_type>::value
+#endif
+                             && std::is_same<std::remove_cv_t<std::remove_pointer_t<decltype(std::declval<const T&>().data())>>, typename T::value_type>::value> {};
+
+template<typename T>
+T byteswap_if_big_endian(T value) {
+#ifdef RANGE_UTILS_BIG_ENDIAN
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    std::reverse(bytes, bytes + sizeof(T));
+    std::memcpy(&value, bytes, sizeof(T));
+#endif
+    return value;
+}
+
+/**
+ * @brief Writes values in the range_utils binary format (see above) to an output_sink.
+ *
+ * Alignment padding is computed from the position in the sink, so the stream is expected to start at the beginning of the sink.
+ */
+class serial_writer {
+public:
+    explicit serial_writer(output_sink& sink) : m_sink(sink) {}
+
+    template<typename T>
+    void write_scalar(T value) {
+        value = byteswap_if_big_endian(value);
+        m_sink.write(&value, sizeof(T));
+    }
+
+    void write_bytes(const void* data, std::size_t size) { m_sink.write(data, size); }
+
+    // Over-aligned types, like alignas(64) structs, can need more padding than the zeros, so it is written in chunks
+    void align(std::size_t alignment) {
+        static const char zeros[alignof(std::max_align_t)] = {};
+        for (std::size_t padding = static_cast<std::size_t>((alignment - m_sink.size() % alignment) % alignment); padding > 0;) {
+            const std::size_t chunk = std::min(padding, sizeof(zeros));
+            write_bytes(zeros, chunk);
+            padding -= chunk;
+        }
+    }
+
+private:
+    output_sink& m_sink;
+};
+
+/**
+ * @brief Reads values in the range_utils binary format from a memory buffer or a mapped file, throwing std::runtime_error on truncated input.
+ */
+class serial_reader {
+public:
+    explicit serial_reader(mapped_file file) {
+        auto shared = std::make_shared<const mapped_file>(std::move(file));
+        m_begin = m_pos = shared->data();
+        m_end = m_begin + shared->size();
+        m_owner = std::move(shared);
+    }
+    // The buffer isn't copied, so it must outlive the reader and the views read from it
+    serial_reader(const char* data, std::size_t size) : m_begin(data), m_pos(data), m_end(data + size) {}
+
+    const char* take(std::size_t size) {
+        if (static_cast<std::size_t>(m_end - m_pos) < size) {
+            throw std::runtime_error("deserialize: truncated input");
+        }
+        const char* data = m_pos;
+        m_pos += size;
+        return data;
+    }
+
+    template<typename T>
+    T read_scalar() {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return byteswap_if_big_endian(value);
+    }
+
+    // Reads an element count, checking that the input can hold at least @p minElementSize bytes per element
+    std::size_t read_count(std::size_t minElementSize) {
+        const std::uint64_t count = read_scalar<std::uint64_t>();
+        if (minElementSize > 0 && count > static_cast<std::uint64_t>(m_end - m_pos) / minElementSize) {
+            throw std::runtime_error("deserialize: truncated input");
+        }
+        return static_cast<std::size_t>(count);
+    }
+
+    void align(std::size_t alignment) { take(static_cast<std::size_t>((alignment - static_cast<std::size_t>(m_pos - m_begin) % alignment) % alignment)); }
+
+    bool at_end() const { return m_pos == m_end; }
+    const std::shared_ptr<const void>& owner() const { return m_owner; }
+
+private:
+    std::shared_ptr<const void> m_owner;
+    const char* m_begin;
+    const char* m_pos;
+    const char* m_end;
+};
+
+/**
+ * @brief This helper writes a value (a number, a container, a map, a tuple or a trivially copyable struct) in the range_utils binary format.
+ *
+ * Contiguous containers of trivially copyable elements, like QVector<double> or std::string, are written as a single block.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * output_sink sink("/cache/prices.bin");
+ * serial_writer writer(sink);
+ * serialize(writer, symbols);                      // QVector<QString>
+ * serialize_columns(writer, timestamps, prices);   // the columns of a make_synchronized() loop
+ * serialize(writer, lastPriceBySymbol);            // QMap<QString, double>
+ * sink.close();
+ * @endcode
+ */
+template<typename T>
+void serialize(serial_writer& writer, const T& value) {
+    if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value) {
+        writer.write_scalar(value);
+    } else if constexpr (is_map_like<T>::value) {
+        writer.write_scalar<std::uint64_t>(static_cast<std::uint64_t>(value.size()));
+        auto writeEntry = [&](const auto& entry) {
+            serialize(writer, entry.first);
+            serialize(writer, entry.second);
+        };
+        if constexpr (has_key_value_range<T>::value) {
+            for (auto&& entry : make_keyval(value)) {
+                writeEntry(entry);
+            }
+        } else {
+            for (const auto& entry : value) {
+                writeEntry(entry);
+            }
+        }
+    } else if constexpr (is_contiguous_block<T>::value) {
+        writer.write_scalar<std::uint64_t>(static_cast<std::uint64_t>(value.size()));
+        writer.align(alignof(typename T::value_type));
+        writer.write_bytes(value.data(), static_cast<std::size_t>(value.size()) * sizeof(typename T::value_type));
+    } else if constexpr (is_sequence_like<T>::value) {
+        writer.write_scalar<std::uint64_t>(static_cast<std::uint64_t>(value.size()));
+        for (const auto& element : value) {
+            serialize(writer, element);
+        }
+    } else if constexpr (is_tuple_like<T>::value) {
+        std::apply([&](const auto&...fields) { (serialize(writer, fields), ...); }, value);
+    } else {
+        static_assert(std::is_trivially_copyable<T>::value, "serialize() requires a number, a container, a tuple or a trivially copyable type");
+        writer.write_bytes(&value, sizeof(T));
+    }
+}
+
+/**
+ * @brief This helper reads back a value written by serialize(), replacing the current content of @p value.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * serial_reader reader(mapped_file("/cache/prices.bin"));
+ * deserialize(reader, symbols);
+ * deserialize_columns(reader, timestamps, prices);
+ * deserialize(reader, lastPriceBySymbol);
+ * @endcode
+ */
+template<typename T>
+void deserialize(serial_reader& reader, T& value) {
+    if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value) {
+        value = reader.read_scalar<T>();
+    } else if constexpr (is_map_like<T>::value) {
+        value.clear();
+        const std::size_t count = reader.read_count(1);
+        for (std::size_t i = 0; i < count; ++i) {
+            typename T::key_type key;
+            typename T::mapped_type mapped;
+            deserialize(reader, key);
+            deserialize(reader, mapped);
+            if constexpr (has_key_value_insert<T>::value) {
+                value.insert(std::move(key), std::move(mapped)); // QMap and QHash
+            } else {
+                value.emplace(std::move(key), std::move(mapped));
+            }
+        }
+    } else if constexpr (is_contiguous_block<T>::value) {
+        using element_type = typename T::value_type;
+        const std::size_t count = reader.read_count(sizeof(element_type));
+        reader.align(alignof(element_type));
+        if constexpr (is_resizable<T>::value) {
+            value.resize(static_cast<decltype(value.size())>(count));
+        } else if (count != static_cast<std::size_t>(value.size())) {
+            throw std::runtime_error("deserialize: element count mismatch for a fixed-size container");
+        }
+        const char* bytes = reader.take(count * sizeof(element_type));
+        if (count > 0) { // data() may be null when empty, which memcpy() doesn't allow even for 0 bytes
+            std::memcpy(static_cast<void*>(value.data()), bytes, count * sizeof(element_type));
+        }
+    } else if constexpr (is_sequence_like<T>::value) {
+        const std::size_t count = reader.read_count(1);
+        if constexpr (is_clearable<T>::value) {
+            value.clear();
+            for (std::size_t i = 0; i < count; ++i) {
+                typename T::value_type element;
+                deserialize(reader, element);
+                value.insert(value.end(), std::move(element));
+            }
+        } else {
+            if (count != static_cast<std::size_t>(value.size())) {
+                throw std::runtime_error("deserialize: element count mismatch for a fixed-size container");
+            }
+            for (auto& element : value) {
+                deserialize(reader, element);
+            }
+        }
+    } else if constexpr (is_tuple_like<T>::value) {
+        std::apply([&](auto&...fields) { (deserialize(reader, fields), ...); }, value);
+    } else {
+        static_assert(std::is_trivially_copyable<T>::value, "deserialize() requires a number, a container, a tuple or a trivially copyable type");
+        std::memcpy(static_cast<void*>(&value), reader.take(sizeof(T)), sizeof(T));
+    }
+}
+
+template<typename T>
+T deserialize(serial_reader& reader) {
+    T value;
+    deserialize(reader, value);
+    return value;
+}
+
+/**
+ * @brief This helper writes a set of columns, like the containers zipped by make_synchronized(), each one as a serialized container.
+ */
+template<typename...Columns>
+void serialize_columns(serial_writer& writer, const Columns&...columns) { (serialize(writer, columns), ...); }
+
+template<typename...Columns>
+void deserialize_columns(serial_reader& reader, Columns&...columns) { (deserialize(reader, columns), ...); }
+
+/**
+ * @brief This helper reads a contiguous container of trivially copyable T written by serialize() as a view, without copying the elements.
+ *
+ * The view is a record_range, so it works with make_reversible(), make_synchronized() and parallel_for_each(),
+ * and it keeps the mapped file of the reader alive. Throws std::runtime_error if the block isn't aligned for T in memory.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * serial_reader reader(mapped_file("/cache/prices.bin"));
+ * auto symbols = deserialize<QVector<QString>>(reader);
+ * auto timestamps = read_view<std::int64_t>(reader);
+ * auto prices = read_view<double>(reader);
+ * for (auto&& [time, price] : make_synchronized(timestamps, prices)) {
+ *     ...
+ * }
+ * @endcode
+ */
+template<typename T>
+record_range<T> read_view(serial_reader& reader) {
+    static_assert(std::is_trivially_copyable<T>::value, "read_view() requires a trivially copyable type");
+#ifdef RANGE_UTILS_BIG_ENDIAN
+    static_assert(!std::is_arithmetic<T>::value, "read_view() can't byteswap numbers in place on big-endian platforms");
+#endif
+    const std::size_t count = reader.read_count(sizeof(T));
+    reader.align(alignof(T));
+    const char* data = reader.take(count * sizeof(T));
+    if (reinterpret_cast<std::uintptr_t>(data) % alignof(T) != 0) {
+        throw std::runtime_error("read_view: the input buffer is not aligned for the element type");
+    }
+    return record_range<T>(reader.owner(), reinterpret_cast<const T*>(data), count);
+}
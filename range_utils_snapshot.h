@@ -0,0 +1,497 @@
+#pragma once
+
+#include "range_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Process-wide epoch-based reclamation, used to free container versions once no reader can still see them.
+ *
+ * Readers pin the current epoch for the duration of a traversal (see epoch_domain::guard), which is a single store
+ * to a per-thread slot and never blocks. Writers retire replaced versions together with the epoch at which they were
+ * unpublished, and a retired version is only deleted once every pinned reader has moved past that epoch.
+ *
+ * Retired objects are reclaimed by the next retire(), and when a reader releases its outermost guard while some are
+ * pending, so that a writer that stops publishing doesn't keep its last versions alive. That release only tries
+ * to reclaim, without waiting for a writer holding the lock. versioned and snapshot_vector also reclaim when destroyed,
+ * and whatever is left is deleted at exit.
+ */
+class epoch_domain {
+    struct reader_slot;
+
+public:
+    /**
+     * @brief RAII pin of the current epoch for the calling thread. Guards can be nested.
+     *
+     * A guard pins the slot of its thread, so it must be released by that thread. Moving it, eg. to hand a snapshot
+     * over to another thread, pins a slot of its own at the same epoch, which any thread can release.
+     */
+    class guard {
+    public:
+        guard() : m_slot(enter()), m_ownsSlot(false) {}
+        guard(guard&& other) : m_slot(other.m_slot), m_ownsSlot(true) {
+            if (!m_slot) {
+                return;
+            }
+            if (other.m_ownsSlot) {
+                other.m_slot = nullptr;
+                return;
+            }
+            m_slot = pin_own_slot(other.m_slot->m_epoch.load(std::memory_order_seq_cst));
+            if (current_thread().m_slot == other.m_slot) {
+                other.m_slot = nullptr; // Otherwise, it is released by its own thread when destroyed
+                leave();
+            }
+        }
+        ~guard() {
+            if (m_slot && m_ownsSlot) {
+                release_own_slot(m_slot);
+            } else if (m_slot) {
+                leave();
+            }
+        }
+
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+        guard& operator=(guard&&) = delete;
+
+    private:
+        reader_slot* m_slot; // The slot pinned by this guard, or nullptr once moved from
+        bool m_ownsSlot;     // Whether the slot was acquired for this guard only, rather than being the slot of its thread
+    };
+
+    /**
+     * @brief Schedules @p object for deletion once all the readers currently pinned have left their epoch.
+     */
+    template<typename T>
+    static void retire(const T* object) { retire(const_cast<T*>(object), [](void* p) { delete static_cast<T*>(p); }); }
+
+    static void retire(void* object, void (*deleter)(void*)) {
+        state& s = instance();
+        std::lock_guard<std::mutex> lock(s.m_retiredMutex);
+        s.m_retired.push_back({object, deleter, s.m_globalEpoch.fetch_add(1, std::memory_order_seq_cst)});
+        reclaim_locked(s);
+    }
+
+    /**
+     * @brief Deletes the retired objects that can no longer be reached by any reader. Called automatically by retire().
+     */
+    static void reclaim() {
+        state& s = instance();
+        std::lock_guard<std::mutex> lock(s.m_retiredMutex);
+        reclaim_locked(s);
+    }
+
+    /**
+     * @brief Like reclaim(), but returns immediately if nothing is pending or another thread holds the lock.
+     * Called automatically when a reader releases its outermost guard.
+     */
+    static void try_reclaim() {
+        state& s = instance();
+        if (s.m_pendingCount.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(s.m_retiredMutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+            reclaim_locked(s);
+        }
+    }
+
+private:
+    // Slots are never freed, only recycled when their thread exits. Padding rather than alignas,
+    // since over-aligned new isn't available before c++17
+    struct reader_slot {
+        std::atomic<std::uint64_t> m_epoch{0}; // 0 when the thread isn't pinned
+        std::atomic<bool> m_inUse{true};
+        reader_slot* m_next = nullptr;
+        char m_padding[64 - sizeof(std::atomic<std::uint64_t>) - sizeof(std::atomic<bool>) - sizeof(reader_slot*)];
+    };
+
+    struct retired_object {
+        void* m_object;
+        void (*m_deleter)(void*);
+        std::uint64_t m_epoch;
+    };
+
+    struct state {
+        ~state() {
+            for (auto& r : m_retired) {
+                r.m_deleter(r.m_object);
+            }
+            for (reader_slot* slot = m_slots.load(); slot;) {
+                reader_slot* next = slot->m_next;
+                delete slot;
+                slot = next;
+            }
+        }
+
+        std::atomic<std::uint64_t> m_globalEpoch{1};
+        std::atomic<reader_slot*> m_slots{nullptr};
+        std::mutex m_retiredMutex;
+        std::vector<retired_object> m_retired;
+        std::atomic<std::size_t> m_pendingCount{0}; // Size of m_retired, readable without the lock
+    };
+
+    struct thread_record {
+        ~thread_record() { if (m_slot) m_slot->m_inUse.store(false, std::memory_order_release); }
+
+        reader_slot* m_slot = nullptr;
+        unsigned m_depth = 0;
+    };
+
+    static state& instance() { static state s; return s; }
+    static thread_record& current_thread() { static thread_local thread_record record; return record; }
+
+    static reader_slot* acquire_slot(state& s) {
+        for (reader_slot* slot = s.m_slots.load(std::memory_order_acquire); slot; slot = slot->m_next) {
+            bool inUse = false;
+            if (!slot->m_inUse.load(std::memory_order_relaxed) && slot->m_inUse.compare_exchange_strong(inUse, true, std::memory_order_acquire)) {
+                return slot;
+            }
+        }
+        auto* slot = new reader_slot;
+        slot->m_next = s.m_slots.load(std::memory_order_relaxed);
+        while (!s.m_slots.compare_exchange_weak(slot->m_next, slot, std::memory_order_release, std::memory_order_relaxed)) {}
+        return slot;
+    }
+
+    static reader_slot* enter() {
+        thread_record& record = current_thread();
+        if (record.m_depth++ > 0) {
+            return record.m_slot;
+        }
+        state& s = instance();
+        if (!record.m_slot) {
+            record.m_slot = acquire_slot(s);
+        }
+        // seq_cst, so that a writer scanning the slots after unpublishing a version either sees this reader pinned,
+        // or this reader loads the new version afterwards
+        record.m_slot->m_epoch.store(s.m_globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        return record.m_slot;
+    }
+
+    static void leave() {
+        thread_record& record = current_thread();
+        if (--record.m_depth == 0) {
+            record.m_slot->m_epoch.store(0, std::memory_order_release);
+            try_reclaim();
+        }
+    }
+
+    // Pins a slot of its own at the epoch of a guard being moved, which stays pinned meanwhile. Under the lock, so that no
+    // writer is scanning the slots, which could otherwise see neither the new slot pinned yet, nor the old one any more
+    static reader_slot* pin_own_slot(std::uint64_t epoch) {
+        state& s = instance();
+        std::lock_guard<std::mutex> lock(s.m_retiredMutex);
+        reader_slot* slot = acquire_slot(s);
+        slot->m_epoch.store(epoch, std::memory_order_seq_cst);
+        return slot;
+    }
+
+    static void release_own_slot(reader_slot* slot) {
+        slot->m_epoch.store(0, std::memory_order_release);
+        slot->m_inUse.store(false, std::memory_order_release);
+        try_reclaim();
+    }
+
+    static void reclaim_locked(state& s) {
+        std::uint64_t oldestPinned = s.m_globalEpoch.load(std::memory_order_seq_cst);
+        for (reader_slot* slot = s.m_slots.load(std::memory_order_acquire); slot; slot = slot->m_next) {
+            const std::uint64_t epoch = slot->m_epoch.load(std::memory_order_seq_cst);
+            if (epoch != 0) {
+                oldestPinned = std::min(oldestPinned, epoch);
+            }
+        }
+        auto reclaimable = std::stable_partition(s.m_retired.begin(), s.m_retired.end(), [oldestPinned](const retired_object& r) { return r.m_epoch >= oldestPinned; });
+        for (auto it = reclaimable; it != s.m_retired.end(); ++it) {
+            it->m_deleter(it->m_object);
+        }
+        s.m_retired.erase(reclaimable, s.m_retired.end());
+        s.m_pendingCount.store(s.m_retired.size(), std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief A container shared between a writer and lock-free readers, updated by publishing whole new versions (read-copy-update).
+ *
+ * read() returns a snapshot that pins the current version for as long as it lives, so readers can iterate it
+ * with make_keyval(), make_reversible() etc. without any lock while updates keep being published.
+ * Writers only serialize with other writers and never wait for readers: replaced versions are reclaimed later
+ * through the epoch_domain.
+ *
+ * Each update() copies the container, which is cheap for implicitly shared Qt containers and reasonable for
+ * rarely updated maps. Use snapshot_vector for large, frequently updated sequences.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * versioned<QMap<QString, int>> counters;
+ *
+ * // writer thread
+ * counters.update([](QMap<QString, int>& map) { map["requests"] += 1; });
+ *
+ * // reader threads
+ * auto snapshot = counters.read();
+ * for (auto [name, count] : make_keyval(*snapshot)) {
+ *     qDebug() << name << "->" << count;
+ * }
+ * @endcode
+ */
+template<typename C>
+class versioned {
+public:
+    class snapshot {
+    public:
+        const C& operator*() const { return *m_version; }
+        const C* operator->() const { return m_version; }
+        const C& get() const { return *m_version; }
+
+    private:
+        friend class versioned;
+        explicit snapshot(const std::atomic<const C*>& current) : m_version(current.load(std::memory_order_seq_cst)) {}
+
+        epoch_domain::guard m_guard; // Must be constructed before loading the version
+        const C* m_version;
+    };
+
+    versioned() : m_current(new C) {}
+    explicit versioned(C value) : m_current(new C(std::move(value))) {}
+    ~versioned() {
+        delete m_current.load(std::memory_order_relaxed);
+        epoch_domain::reclaim(); // The retired versions, unless readers still pin them
+    }
+
+    versioned(const versioned&) = delete;
+    versioned& operator=(const versioned&) = delete;
+
+    snapshot read() const { return snapshot(m_current); }
+
+    /**
+     * @brief Applies @p func to a private copy of the current version, then publishes it. Nothing is published if @p func throws.
+     */
+    template<typename Func>
+    void update(Func&& func) {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        std::unique_ptr<C> next(new C(*m_current.load(std::memory_order_relaxed)));
+        func(*next);
+        epoch_domain::retire(m_current.exchange(next.release(), std::memory_order_seq_cst));
+    }
+
+    void store(C value) {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        epoch_domain::retire(m_current.exchange(new C(std::move(value)), std::memory_order_seq_cst));
+    }
+
+private:
+    std::atomic<const C*> m_current;
+    std::mutex m_writeMutex;
+};
+
+/**
+ * @brief A vector shared between a writer and lock-free readers, stored as copy-on-write blocks of @p BlockSize elements.
+ *
+ * Like versioned<C>, readers iterate a consistent snapshot without locking and writers never wait for readers,
+ * but an update only copies the table of block pointers plus the blocks it actually modifies, so the cost
+ * of a small update doesn't grow with the vector size. Unmodified blocks are shared between versions.
+ *
+ * Snapshots are random-access containers, so they work with make_reversible(), make_synchronized()
+ * and parallel_for_each().
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * snapshot_vector<double> prices;
+ *
+ * // writer thread
+ * prices.update([&](snapshot_vector<double>::writer& w) {
+ *     w.set(42, 19.99);
+ *     w.push_back(5.0);
+ * });
+ *
+ * // reader threads
+ * auto snapshot = prices.read();
+ * for (const double& price : make_reversible(snapshot)) {
+ *     ...
+ * }
+ * @endcode
+ */
+template<typename T, std::size_t BlockSize = 512>
+class snapshot_vector {
+    static_assert(BlockSize > 0 && (BlockSize & (BlockSize - 1)) == 0, "BlockSize must be a power of two");
+
+    using block = std::vector<T>;
+
+    struct version {
+        std::size_t m_size = 0;
+        std::vector<std::shared_ptr<block>> m_blocks; // Blocks are immutable once published
+    };
+
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+        const_iterator(const version* v, std::size_t index) : m_version(v), m_index(index) {}
+
+        reference operator*() const { return (*m_version->m_blocks[m_index / BlockSize])[m_index % BlockSize]; }
+        pointer operator->() const { return &**this; }
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        const_iterator& operator++() { ++m_index; return *this; }
+        const_iterator operator++(int) { const_iterator it = *this; ++m_index; return it; }
+        const_iterator& operator--() { --m_index; return *this; }
+        const_iterator operator--(int) { const_iterator it = *this; --m_index; return it; }
+        const_iterator& operator+=(difference_type n) { m_index += n; return *this; }
+        const_iterator& operator-=(difference_type n) { m_index -= n; return *this; }
+        friend const_iterator operator+(const_iterator it, difference_type n) { return it += n; }
+        friend const_iterator operator+(difference_type n, const_iterator it) { return it += n; }
+        friend const_iterator operator-(const_iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const const_iterator& lhs, const const_iterator& rhs) { return static_cast<difference_type>(lhs.m_index) - static_cast<difference_type>(rhs.m_index); }
+
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) { return lhs.m_index == rhs.m_index; }
+        friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) { return lhs.m_index != rhs.m_index; }
+        friend bool operator<(const const_iterator& lhs, const const_iterator& rhs) { return lhs.m_index < rhs.m_index; }
+        friend bool operator>(const const_iterator& lhs, const const_iterator& rhs) { return lhs.m_index > rhs.m_index; }
+        friend bool operator<=(const const_iterator& lhs, const const_iterator& rhs) { return lhs.m_index <= rhs.m_index; }
+        friend bool operator>=(const const_iterator& lhs, const const_iterator& rhs) { return lhs.m_index >= rhs.m_index; }
+
+    private:
+        const version* m_version = nullptr;
+        std::size_t m_index = 0;
+    };
+
+    /**
+     * @brief A consistent, read-only view of the vector at the time read() was called. Keeps its version alive while it exists.
+     */
+    class snapshot {
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using const_iterator = snapshot_vector::const_iterator;
+        using iterator = const_iterator;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+        using reverse_iterator = const_reverse_iterator;
+
+        std::size_t size() const { return m_version->m_size; }
+        bool empty() const { return size() == 0; }
+        const T& operator[](std::size_t i) const { return (*m_version->m_blocks[i / BlockSize])[i % BlockSize]; }
+
+        const_iterator begin() const { return {m_version, 0}; }
+        const_iterator end() const { return {m_version, size()}; }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+        const_reverse_iterator crbegin() const { return rbegin(); }
+        const_reverse_iterator crend() const { return rend(); }
+
+    private:
+        friend class snapshot_vector;
+        explicit snapshot(const std::atomic<const version*>& current) : m_version(current.load(std::memory_order_seq_cst)) {}
+
+        epoch_domain::guard m_guard; // Must be constructed before loading the version
+        const version* m_version;
+    };
+
+    /**
+     * @brief Mutation interface passed to update(). Blocks are copied at most once per update, on their first modification.
+     */
+    class writer {
+    public:
+        std::size_t size() const { return m_next->m_size; }
+        const T& operator[](std::size_t i) const { return (*m_next->m_blocks[i / BlockSize])[i % BlockSize]; }
+
+        void set(std::size_t i, T value) { mutable_block(i / BlockSize)[i % BlockSize] = std::move(value); }
+
+        void push_back(T value) {
+            const std::size_t blockIndex = m_next->m_size / BlockSize;
+            if (blockIndex == m_next->m_blocks.size()) {
+                m_next->m_blocks.push_back(std::make_shared<block>());
+                m_next->m_blocks.back()->reserve(BlockSize);
+                m_owned.push_back(true);
+            }
+            mutable_block(blockIndex).push_back(std::move(value));
+            ++m_next->m_size;
+        }
+
+        void pop_back() {
+            --m_next->m_size;
+            const std::size_t blockIndex = m_next->m_size / BlockSize;
+            const std::size_t kept = m_next->m_size % BlockSize;
+            if (kept == 0) {
+                m_next->m_blocks.pop_back(); // It only held the popped element
+                m_owned.pop_back();
+            } else if (m_owned[blockIndex]) {
+                m_next->m_blocks[blockIndex]->pop_back();
+            } else {
+                // Only copies the elements that remain, rather than the whole block like mutable_block()
+                const block& shared = *m_next->m_blocks[blockIndex];
+                auto copy = std::make_shared<block>();
+                copy->reserve(BlockSize);
+                copy->assign(shared.begin(), shared.begin() + static_cast<std::ptrdiff_t>(kept));
+                m_next->m_blocks[blockIndex] = std::move(copy);
+                m_owned[blockIndex] = true;
+            }
+        }
+
+        void clear() { m_next->m_blocks.clear(); m_owned.clear(); m_next->m_size = 0; }
+
+    private:
+        friend class snapshot_vector;
+        explicit writer(const version& current) : m_next(new version(current)), m_owned(current.m_blocks.size(), false) {}
+
+        block& mutable_block(std::size_t blockIndex) {
+            if (!m_owned[blockIndex]) {
+                m_next->m_blocks[blockIndex] = std::make_shared<block>(*m_next->m_blocks[blockIndex]);
+                m_next->m_blocks[blockIndex]->reserve(BlockSize);
+                m_owned[blockIndex] = true;
+            }
+            return *m_next->m_blocks[blockIndex];
+        }
+
+        std::unique_ptr<version> m_next;
+        std::vector<bool> m_owned;
+    };
+
+    snapshot_vector() : m_current(new version) {}
+    ~snapshot_vector() {
+        delete m_current.load(std::memory_order_relaxed);
+        epoch_domain::reclaim(); // The retired versions, unless readers still pin them
+    }
+
+    snapshot_vector(const snapshot_vector&) = delete;
+    snapshot_vector& operator=(const snapshot_vector&) = delete;
+
+    snapshot read() const { return snapshot(m_current); }
+
+    /**
+     * @brief Applies @p func to a writer over the current version, then publishes the result. Nothing is published if @p func throws.
+     */
+    template<typename Func>
+    void update(Func&& func) {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        writer w(*m_current.load(std::memory_order_relaxed));
+        func(w);
+        epoch_domain::retire(m_current.exchange(w.m_next.release(), std::memory_order_seq_cst));
+    }
+
+    void set(std::size_t i, T value) { update([&](writer& w) { w.set(i, std::move(value)); }); }
+    void push_back(T value) { update([&](writer& w) { w.push_back(std::move(value)); }); }
+
+private:
+    std::atomic<const version*> m_current;
+    std::mutex m_writeMutex;
+};
@@ -0,0 +1,362 @@
+#pragma once
+
+#include "range_utils_io.h"
+
+#if __cplusplus < 201703L
+#error "range_utils_text.h requires C++17"
+#endif
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Returns the position of the first '\n' in [first, last), or last. Lines are usually short, so an inline
+// 16 bytes at a time scan beats calling memchr() for each of them.
+inline const char* find_newline(const char* first, const char* last) {
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; last - first >= 16; first += 16) {
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first)), newline));
+        if (mask != 0) {
+            return first + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+#endif
+    const void* found = first == last ? nullptr : std::memchr(first, '\n', static_cast<std::size_t>(last - first));
+    return found ? static_cast<const char*>(found) : last;
+}
+
+/**
+ * @brief Range of the lines of a text buffer, as std::string_view without the line terminator ("\n" or "\r\n").
+ *
+ * A final line without a terminator is included, and a terminator at the end of the buffer doesn't add an empty line.
+ * The range is splittable, at line boundaries, so it can be processed with parallel_for_each().
+ */
+class line_range {
+public:
+    struct iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::string_view;
+
+        std::string_view operator*() const {
+            const char* lineEnd = m_next;
+            if (lineEnd != m_pos && lineEnd[-1] == '\r') {
+                --lineEnd;
+            }
+            return std::string_view(m_pos, static_cast<std::size_t>(lineEnd - m_pos));
+        }
+        iterator& operator++() {
+            m_pos = m_next == m_end ? m_end : m_next + 1;
+            m_next = find_newline(m_pos, m_end);
+            return *this;
+        }
+        iterator operator++(int) { iterator it = *this; ++*this; return it; }
+
+        friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.m_pos == rhs.m_pos; }
+        friend bool operator!=(const iterator& lhs, const iterator& rhs) { return lhs.m_pos != rhs.m_pos; }
+
+        const char* m_pos;  // Start of the current line
+        const char* m_next; // Its terminating '\n', or m_end
+        const char* m_end;
+    };
+    using const_iterator = iterator;
+    using value_type = std::string_view;
+
+    line_range(const char* first, const char* last, std::shared_ptr<const void> owner = nullptr) : m_begin(first), m_end(last), m_owner(std::move(owner)) {}
+
+    iterator begin() const { return {m_begin, find_newline(m_begin, m_end), m_end}; }
+    iterator end() const { return {m_end, m_end, m_end}; }
+
+    // Returns the range without its first line, typically a header
+    line_range drop_first() const {
+        iterator it = begin();
+        if (it != end()) {
+            ++it;
+        }
+        return line_range(it.m_pos, m_end, m_owner);
+    }
+
+    // The split protocol counts bytes rather than lines, which would need a full scan. The split point is the first line
+    // boundary after the middle, or else the last one before it, since a long line may span the whole second half.
+    // A single line can't be split, and returns itself and an empty range.
+    std::size_t size_hint() const { return static_cast<std::size_t>(m_end - m_begin); }
+    std::pair<line_range, line_range> split() const {
+        const char* half = m_begin + size_hint() / 2;
+        const char* last = m_begin == m_end ? m_end : m_end - 1; // A final '\n' ends the last line rather than splitting
+        const char* middle = find_newline(half, last);
+        if (middle != last) {
+            ++middle;
+        } else {
+            const auto before = std::find(std::make_reverse_iterator(half), std::make_reverse_iterator(m_begin), '\n');
+            middle = before.base() == m_begin ? m_end : before.base();
+        }
+        return {line_range(m_begin, middle, m_owner), line_range(middle, m_end, m_owner)};
+    }
+
+private:
+    const char* m_begin;
+    const char* m_end;
+    std::shared_ptr<const void> m_owner; // Keeps the mapping or the moved-in buffer alive, if the range owns one
+};
+
+/**
+ * @brief This helper iterates over the lines of a memory-mapped file within a range-for loop, without any allocation per line.
+ *
+ * Lines are std::string_view into the mapping, which stays alive as long as the range (or a copy of it).
+ * Newlines are found 16 bytes at a time with SSE2 when available, and "\r\n" terminators are handled.
+ * The range can be split at line boundaries for parallel_for_each().
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * std::size_t errors = 0;
+ * for (std::string_view line : make_lines(mapped_file("/var/log/app.log"))) {
+ *     if (line.substr(0, 5) == "ERROR")
+ *         ++errors;
+ * }
+ *
+ * std::atomic<std::size_t> warnings{0};
+ * parallel_for_each(make_lines(mapped_file("/var/log/app.log")), [&](std::string_view line) {
+ *     if (line.find("WARN") != std::string_view::npos)
+ *         ++warnings;
+ * });
+ * @endcode
+ */
+inline line_range make_lines(mapped_file file) {
+    auto shared = std::make_shared<const mapped_file>(std::move(file));
+    return line_range(shared->data(), shared->data() + shared->size(), shared);
+}
+
+/**
+ * @brief This overload iterates over the lines of an in-memory buffer with data() and size(), like QByteArray or std::string.
+ *
+ * The buffer isn't copied, so it must outlive the range.
+ */
+template<typename Buffer>
+auto make_lines(const Buffer& buffer) -> decltype(buffer.data(), buffer.size(), line_range(nullptr, nullptr)) {
+    const char* data = buffer.data();
+    return line_range(data, data + buffer.size());
+}
+
+/**
+ * @brief This overload takes temporary buffers, like make_lines(reply->readAll()), which are moved into the range.
+ *
+ * The buffer stays alive as long as the range (or a copy of it), like the mapping of a mapped_file.
+ */
+template<typename Buffer>
+auto make_lines(Buffer&& buffer) -> std::enable_if_t<!std::is_reference<Buffer>::value, decltype(buffer.data(), buffer.size(), line_range(nullptr, nullptr))> {
+    auto shared = std::make_shared<const Buffer>(std::move(buffer)); // The data is only taken after the move, which may change it (eg. small strings)
+    const char* data = shared->data();
+    return line_range(data, data + shared->size(), shared);
+}
+
+struct csv_options {
+    char separator = ',';
+    bool hasHeader = true; // Skips the first line
+};
+
+// Field parsers for make_csv(), throwing std::invalid_argument when the whole field isn't a valid value
+inline void parse_csv_field(std::string_view field, std::string_view& value) { value = field; }
+inline void parse_csv_field(std::string_view field, std::string& value) { value.assign(field.data(), field.size()); }
+
+template<typename T>
+auto parse_csv_field(std::string_view field, T& value) -> std::enable_if_t<std::is_arithmetic<T>::value> {
+    const char* first = field.data();
+    const char* last = first + field.size();
+    if (first != last && *first == '+') {
+        ++first; // from_chars() only accepts a leading '-'
+    }
+    const auto result = std::from_chars(first, last, value);
+    if (result.ec != std::errc() || result.ptr != last) {
+        throw std::invalid_argument("make_csv: invalid field '" + std::string(field) + "'");
+    }
+}
+
+/**
+ * @brief Range of the rows of a CSV text, each one a std::tuple of the selected columns parsed as Types.
+ *
+ * Only the fields up to the last selected column are scanned, and only the selected ones are parsed.
+ * Fields can be enclosed in double quotes to contain the separator, but they are not unescaped
+ * ("" stays as is) and can't span several lines. Empty lines are skipped.
+ */
+template<typename...Types>
+class csv_range {
+public:
+    using value_type = std::tuple<Types...>;
+    using columns_type = std::array<std::size_t, sizeof...(Types)>;
+
+    struct iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = csv_range::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        value_type operator*() const { return m_range->parse(*m_line); }
+        iterator& operator++() { ++m_line; skip_empty(); return *this; }
+        iterator operator++(int) { iterator it = *this; ++*this; return it; }
+
+        friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.m_line == rhs.m_line; }
+        friend bool operator!=(const iterator& lhs, const iterator& rhs) { return lhs.m_line != rhs.m_line; }
+
+        void skip_empty() {
+            while (m_line != m_end && (*m_line).empty()) {
+                ++m_line;
+            }
+        }
+
+        const csv_range* m_range;
+        line_range::iterator m_line;
+        line_range::iterator m_end;
+    };
+    using const_iterator = iterator;
+
+    csv_range(line_range lines, const columns_type& columns, char separator) : m_lines(std::move(lines)), m_separator(separator) {
+        std::size_t lastColumn = 0;
+        for (std::size_t column : columns) {
+            lastColumn = std::max(lastColumn, column);
+        }
+        m_slots.assign(lastColumn + 1, -1);
+        for (std::size_t i = 0; i < columns.size(); ++i) {
+            if (m_slots[columns[i]] < 0) {
+                m_slots[columns[i]] = static_cast<int>(i);
+            }
+            m_sources[i] = static_cast<std::size_t>(m_slots[columns[i]]);
+        }
+    }
+
+    iterator begin() const {
+        iterator it{this, m_lines.begin(), m_lines.end()};
+        it.skip_empty();
+        return it;
+    }
+    iterator end() const { return {this, m_lines.end(), m_lines.end()}; }
+
+    std::size_t size_hint() const { return m_lines.size_hint(); }
+    std::pair<csv_range, csv_range> split() const {
+        auto halves = m_lines.split();
+        return {csv_range(std::move(halves.first), *this), csv_range(std::move(halves.second), *this)};
+    }
+
+private:
+    csv_range(line_range lines, const csv_range& other) : m_lines(std::move(lines)), m_slots(other.m_slots), m_sources(other.m_sources), m_separator(other.m_separator) {}
+
+    value_type parse(std::string_view line) const {
+        std::array<std::string_view, sizeof...(Types)> fields;
+        const char* pos = line.data();
+        const char* end = pos + line.size();
+        for (std::size_t column = 0; column < m_slots.size(); ++column) {
+            const char* fieldBegin = pos;
+            const char* fieldEnd;
+            if (pos != end && *pos == '"') {
+                const char* quote = pos + 1;
+                while ((quote = static_cast<const char*>(std::memchr(quote, '"', static_cast<std::size_t>(end - quote)))) && quote + 1 != end && quote[1] == '"') {
+                    quote += 2; // Escaped quote
+                }
+                if (!quote) {
+                    throw std::invalid_argument("make_csv: unterminated quote in '" + std::string(line) + "'");
+                }
+                fieldBegin = pos + 1;
+                fieldEnd = quote;
+                pos = quote + 1;
+                if (pos != end && *pos != m_separator) {
+                    throw std::invalid_argument("make_csv: unexpected character after quote in '" + std::string(line) + "'");
+                }
+            } else {
+                const void* separator = std::memchr(pos, m_separator, static_cast<std::size_t>(end - pos));
+                fieldEnd = pos = separator ? static_cast<const char*>(separator) : end;
+            }
+            if (m_slots[column] >= 0) {
+                fields[static_cast<std::size_t>(m_slots[column])] = std::string_view(fieldBegin, static_cast<std::size_t>(fieldEnd - fieldBegin));
+            }
+            if (column + 1 < m_slots.size()) {
+                if (pos == end) {
+                    throw std::invalid_argument("make_csv: missing columns in '" + std::string(line) + "'");
+                }
+                ++pos; // Past the separator
+            }
+        }
+        for (std::size_t i = 0; i < fields.size(); ++i) {
+            fields[i] = fields[m_sources[i]];
+        }
+        return parse_fields(fields, std::index_sequence_for<Types...>());
+    }
+
+    template<std::size_t...Is>
+    static value_type parse_fields(const std::array<std::string_view, sizeof...(Types)>& fields, std::index_sequence<Is...>) {
+        value_type row;
+        (parse_csv_field(fields[Is], std::get<Is>(row)), ...);
+        return row;
+    }
+
+    line_range m_lines;
+    std::vector<int> m_slots; // Index in the row tuple for each column up to the last selected one, or -1 when it is skipped
+    columns_type m_sources;   // For each index in the row tuple, the first index selecting the same column, which m_slots fills
+    char m_separator;
+};
+
+template<std::size_t N>
+std::array<std::size_t, N> csv_leading_columns() {
+    std::array<std::size_t, N> columns;
+    for (std::size_t i = 0; i < N; ++i) {
+        columns[i] = i;
+    }
+    return columns;
+}
+
+/**
+ * @brief These overloads of make_csv() (see below) allow changing the separator, and reading files without a header line.
+ *
+ * They are declared first, since the other overloads forward to them.
+ */
+template<typename...Types>
+csv_range<Types...> make_csv(csv_options options, line_range lines, const std::array<std::size_t, sizeof...(Types)>& columns) {
+    return csv_range<Types...>(options.hasHeader ? lines.drop_first() : std::move(lines), columns, options.separator);
+}
+template<typename...Types>
+csv_range<Types...> make_csv(csv_options options, line_range lines) { return make_csv<Types...>(options, std::move(lines), csv_leading_columns<sizeof...(Types)>()); }
+
+/**
+ * @brief This helper reads the lines of a CSV text as rows of typed fields, parsing only the selected @p columns.
+ *
+ * Each row is a std::tuple<Types...> of the given columns in the given order: std::string_view fields point into
+ * the text without copies, and numbers are parsed with std::from_chars(). Invalid fields throw std::invalid_argument.
+ * A column can be selected several times, eg. to read it both as text and as a number.
+ * Like make_lines(), the range can be split for parallel_for_each().
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * // symbol,date,open,high,low,close,volume
+ * double turnover = 0;
+ * for (auto [symbol, close, volume] : make_csv<std::string_view, double, long>(make_lines(mapped_file("/data/quotes.csv")), {0, 5, 6})) {
+ *     turnover += close * volume;
+ * }
+ * @endcode
+ */
+template<typename...Types>
+csv_range<Types...> make_csv(line_range lines, const std::array<std::size_t, sizeof...(Types)>& columns) { return make_csv<Types...>(csv_options(), std::move(lines), columns); }
+
+/**
+ * @brief This overload reads the first sizeof...(Types) columns.
+ */
+template<typename...Types>
+csv_range<Types...> make_csv(line_range lines) { return make_csv<Types...>(csv_options(), std::move(lines), csv_leading_columns<sizeof...(Types)>()); }
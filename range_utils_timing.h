@@ -0,0 +1,354 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Call-site timing of the range-for loops over the helpers, enabled by defining RANGE_UTILS_TIMING before including range_utils.h
+//
+// The begin() of the adapters then takes a defaulted range_call_site argument, which the compiler fills with the location
+// of the range-for loop, and returns an iterator that times the traversal until it is destroyed, ie. until the loop exits.
+// Only one traversal every RANGE_UTILS_TIMING_SAMPLE_PERIOD per thread is timed, to keep the overhead low:
+// a traversal that isn't sampled costs a thread-local increment and a branch.
+// Traversals through split() (eg. parallel_for_each()) are not timed.
+
+#ifndef RANGE_UTILS_TIMING_SAMPLE_PERIOD
+#define RANGE_UTILS_TIMING_SAMPLE_PERIOD 64
+#endif
+
+struct range_call_site {
+    const char* m_file;
+    int m_line;
+
+    // Default arguments are evaluated at the call site, so this returns the location of the outermost caller
+    // that doesn't pass a range_call_site explicitly, like std::source_location::current() in c++20
+    static range_call_site current(const char* file = __builtin_FILE(), int line = __builtin_LINE()) { return {file, line}; }
+};
+
+/**
+ * @brief Per-call-site histograms of the traversal durations of the range-for loops over the helpers.
+ *
+ * Each thread records its samples into its own table, with relaxed atomics and no locks, and snapshot() merges the tables
+ * of all the threads. Tables are never freed, and are reused by new threads when their thread exits, so that the samples
+ * of short-lived threads are kept.
+ *
+ * Usage example:
+ *
+ * @code{.cpp}
+ * #define RANGE_UTILS_TIMING
+ * #include "range_utils.h"
+ *
+ * for (auto&& [order, customer] : make_synchronized(orders, customers)) { // timed as "orders.cpp:42"
+ *     ...
+ * }
+ * ...
+ * range_timing::write_text(std::cerr); // or write_json(), sorted by total sampled time
+ * @endcode
+ */
+class range_timing {
+public:
+    // Bucket 0 counts durations of 0ns, and bucket i > 0 the durations in [2^(i-1), 2^i) ns
+    static constexpr std::size_t BucketCount = 40;
+    // Call sites per thread, beyond which the samples are counted in a single "other" site
+    static constexpr std::size_t SiteCapacity = 64;
+
+    struct site_stats {
+        std::string m_file;
+        int m_line;
+        std::uint64_t m_samples;
+        std::uint64_t m_totalNs;
+        std::array<std::uint64_t, BucketCount> m_buckets;
+
+        double mean_ns() const { return m_samples > 0 ? static_cast<double>(m_totalNs) / static_cast<double>(m_samples) : 0.0; }
+        // Upper bound of the bucket containing the p-th quantile
+        std::uint64_t quantile_ns(double p) const {
+            const double rank = p * static_cast<double>(m_samples);
+            std::uint64_t count = 0;
+            for (std::size_t i = 0; i < BucketCount; ++i) {
+                count += m_buckets[i];
+                if (count > 0 && static_cast<double>(count) >= rank) {
+                    return i == 0 ? 0 : std::uint64_t(1) << i;
+                }
+            }
+            return std::uint64_t(1) << BucketCount;
+        }
+    };
+
+    // Merged over all the threads, sorted by decreasing total sampled time
+    static std::vector<site_stats> snapshot() {
+        std::vector<site_stats> sites;
+        for (thread_table* table = tables().load(std::memory_order_acquire); table; table = table->m_next) {
+            for (const site_slot& slot : table->m_slots) {
+                const char* file = slot.m_file.load(std::memory_order_acquire);
+                if (file) {
+                    merge(sites, file, slot.m_line.load(std::memory_order_relaxed), slot);
+                }
+            }
+            merge(sites, "other", 0, table->m_overflow);
+        }
+        sites.erase(std::remove_if(sites.begin(), sites.end(), [](const site_stats& site) { return site.m_samples == 0; }), sites.end());
+        std::sort(sites.begin(), sites.end(), [](const site_stats& lhs, const site_stats& rhs) { return lhs.m_totalNs > rhs.m_totalNs; });
+        return sites;
+    }
+
+    // Resets the samples of all the threads. Samples recorded concurrently may be partially lost
+    static void reset() {
+        for (thread_table* table = tables().load(std::memory_order_acquire); table; table = table->m_next) {
+            for (site_slot& slot : table->m_slots) {
+                slot.clear();
+            }
+            table->m_overflow.clear();
+        }
+    }
+
+    static void write_text(std::ostream& out) {
+        out << "samples  est. traversals    total ms     mean us      p50 us      p99 us  call site\n";
+        char line[128];
+        for (const site_stats& site : snapshot()) {
+            std::snprintf(line, sizeof(line), "%7llu  %15llu  %10.3f  %10.3f  %10.3f  %10.3f  ", static_cast<unsigned long long>(site.m_samples),
+                          static_cast<unsigned long long>(site.m_samples * RANGE_UTILS_TIMING_SAMPLE_PERIOD), static_cast<double>(site.m_totalNs) / 1e6,
+                          site.mean_ns() / 1e3, static_cast<double>(site.quantile_ns(0.5)) / 1e3, static_cast<double>(site.quantile_ns(0.99)) / 1e3);
+            out << line << site.m_file << ':' << site.m_line << '\n';
+        }
+    }
+
+    static void write_json(std::ostream& out) {
+        out << "{\"samplePeriod\":" << RANGE_UTILS_TIMING_SAMPLE_PERIOD << ",\"sites\":[";
+        bool first = true;
+        for (const site_stats& site : snapshot()) {
+            out << (first ? "" : ",") << "{\"file\":\"";
+            for (char c : site.m_file) {
+                if (c == '"' || c == '\\') {
+                    out << '\\';
+                }
+                out << c;
+            }
+            out << "\",\"line\":" << site.m_line << ",\"samples\":" << site.m_samples << ",\"totalNs\":" << site.m_totalNs << ",\"histogram\":[";
+            for (std::size_t i = 0; i < BucketCount; ++i) {
+                out << (i > 0 ? "," : "") << site.m_buckets[i];
+            }
+            out << "]}";
+            first = false;
+        }
+        out << "]}\n";
+    }
+
+    // Whether the traversal starting now on this thread should be timed
+    static bool should_sample() {
+        static thread_local std::uint32_t traversals = 0;
+        return ++traversals % RANGE_UTILS_TIMING_SAMPLE_PERIOD == 0;
+    }
+
+    static void record(range_call_site site, std::uint64_t ns) {
+        site_slot& slot = current_table().find_or_insert(site);
+        std::size_t bucket = 0;
+        while (bucket + 1 < BucketCount && (ns >> bucket) > 0) {
+            ++bucket;
+        }
+        // Only the owning thread writes to its table, so the increments don't need to be atomic read-modify-writes
+        add(slot.m_samples, 1);
+        add(slot.m_totalNs, ns);
+        add(slot.m_buckets[bucket], 1);
+    }
+
+private:
+    struct site_slot {
+        std::atomic<const char*> m_file{nullptr}; // Published last, so that readers see m_line once m_file is set
+        std::atomic<int> m_line{0};
+        std::atomic<std::uint64_t> m_samples{0};
+        std::atomic<std::uint64_t> m_totalNs{0};
+        std::array<std::atomic<std::uint64_t>, BucketCount> m_buckets{};
+
+        void clear() {
+            m_samples.store(0, std::memory_order_relaxed);
+            m_totalNs.store(0, std::memory_order_relaxed);
+            for (auto& bucket : m_buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct thread_table {
+        site_slot& find_or_insert(range_call_site site) {
+            const std::size_t hash = (reinterpret_cast<std::uintptr_t>(site.m_file) >> 3) ^ (static_cast<std::size_t>(site.m_line) * 0x9E3779B1u);
+            for (std::size_t i = 0; i < SiteCapacity; ++i) {
+                site_slot& slot = m_slots[(hash + i) % SiteCapacity];
+                const char* file = slot.m_file.load(std::memory_order_relaxed);
+                if (!file) {
+                    slot.m_line.store(site.m_line, std::memory_order_relaxed);
+                    slot.m_file.store(site.m_file, std::memory_order_release);
+                    return slot;
+                }
+                if (file == site.m_file && slot.m_line.load(std::memory_order_relaxed) == site.m_line) {
+                    return slot;
+                }
+            }
+            return m_overflow;
+        }
+
+        std::array<site_slot, SiteCapacity> m_slots;
+        site_slot m_overflow;
+        std::atomic<bool> m_inUse{true};
+        thread_table* m_next = nullptr;
+    };
+
+    struct thread_record {
+        ~thread_record() { if (m_table) m_table->m_inUse.store(false, std::memory_order_release); }
+
+        thread_table* m_table = nullptr;
+    };
+
+    static void add(std::atomic<std::uint64_t>& counter, std::uint64_t n) { counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+    static std::atomic<thread_table*>& tables() { static std::atomic<thread_table*> head{nullptr}; return head; }
+
+    static thread_table& current_table() {
+        static thread_local thread_record record;
+        if (!record.m_table) {
+            record.m_table = acquire_table();
+        }
+        return *record.m_table;
+    }
+
+    static thread_table* acquire_table() {
+        for (thread_table* table = tables().load(std::memory_order_acquire); table; table = table->m_next) {
+            bool inUse = false;
+            if (!table->m_inUse.load(std::memory_order_relaxed) && table->m_inUse.compare_exchange_strong(inUse, true, std::memory_order_acquire)) {
+                return table;
+            }
+        }
+        auto* table = new thread_table;
+        table->m_next = tables().load(std::memory_order_relaxed);
+        while (!tables().compare_exchange_weak(table->m_next, table, std::memory_order_release, std::memory_order_relaxed)) {}
+        return table;
+    }
+
+    // Call sites are compared by file name, since the same file name may have a different address in each translation unit
+    static void merge(std::vector<site_stats>& sites, const char* file, int line, const site_slot& slot) {
+        auto it = std::find_if(sites.begin(), sites.end(), [&](const site_stats& site) { return site.m_line == line && site.m_file == file; });
+        if (it == sites.end()) {
+            sites.push_back({file, line, 0, 0, {}});
+            it = sites.end() - 1;
+        }
+        it->m_samples += slot.m_samples.load(std::memory_order_relaxed);
+        it->m_totalNs += slot.m_totalNs.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < BucketCount; ++i) {
+            it->m_buckets[i] += slot.m_buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+/**
+ * @brief Times a traversal from its construction in begin() to its destruction, if it is sampled and the traversal did happen.
+ *
+ * Only the iterator returned by begin() owns a timer: copies of the iterator don't time anything, while moves transfer the timer.
+ */
+class range_timer {
+public:
+    using clock = std::chrono::steady_clock;
+
+    range_timer() = default;
+    explicit range_timer(range_call_site site) : m_site(site), m_active(range_timing::should_sample()) {
+        if (m_active) {
+            m_start = clock::now();
+        }
+    }
+    range_timer(const range_timer&) noexcept {}
+    range_timer(range_timer&& other) noexcept : m_site(other.m_site), m_start(other.m_start), m_active(other.m_active), m_traversed(other.m_traversed) { other.m_active = false; }
+    range_timer& operator=(const range_timer&) noexcept { return *this; }
+    ~range_timer() {
+        if (m_active && m_traversed) {
+            range_timing::record(m_site, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - m_start).count()));
+        }
+    }
+
+    // Called on increments and on reaching the end, so that begin() calls without a loop, like in split(), aren't recorded
+    void mark_traversed() const noexcept { m_traversed = true; }
+
+private:
+    range_call_site m_site{nullptr, 0};
+    clock::time_point m_start;
+    bool m_active = false;
+    mutable bool m_traversed = false;
+};
+
+template<typename It, typename = void>
+struct iterator_concept_or_category {
+    using type = typename std::iterator_traits<It>::iterator_category;
+};
+template<typename It>
+struct iterator_concept_or_category<It, std::conditional_t<true, void, typename It::iterator_concept>> {
+    using type = typename It::iterator_concept;
+};
+
+template<typename It, typename = void>
+struct timed_iterator_traits {};
+template<typename It>
+struct timed_iterator_traits<It, std::conditional_t<true, void, typename std::iterator_traits<It>::iterator_category>> {
+    using iterator_category = typename std::iterator_traits<It>::iterator_category;
+    using value_type = typename std::iterator_traits<It>::value_type;
+    using difference_type = typename std::iterator_traits<It>::difference_type;
+    using pointer = typename std::iterator_traits<It>::pointer;
+    using reference = typename std::iterator_traits<It>::reference;
+    // Only forward traversal is wrapped, so that C++20 ranges see timed iterators as forward iterators at most
+    using iterator_concept = std::conditional_t<std::is_base_of<std::forward_iterator_tag, typename iterator_concept_or_category<It>::type>::value, std::forward_iterator_tag,
+                                                std::input_iterator_tag>;
+};
+
+/**
+ * @brief Iterator wrapper carrying the range_timer of a traversal, returned by the begin() and end() of the adapters.
+ */
+template<typename It>
+struct timed_iterator : timed_iterator_traits<It> {
+    timed_iterator() = default;
+    timed_iterator(It it) : m_it(std::move(it)) {}
+    timed_iterator(It it, range_call_site site) : m_it(std::move(it)), m_timer(site) {}
+
+    decltype(auto) operator*() { return *m_it; }
+    template<typename I = It>
+    auto operator*() const -> decltype(*std::declval<const I&>()) { return *m_it; }
+    timed_iterator& operator++() { m_timer.mark_traversed(); ++m_it; return *this; }
+    timed_iterator operator++(int) { timed_iterator copy = *this; ++*this; return copy; }
+    template<typename N, typename = decltype(std::declval<It&>() += std::declval<N>())>
+    timed_iterator& operator+=(N n) { m_it += n; return *this; }
+
+    friend bool operator!=(const timed_iterator& lhs, const timed_iterator& rhs) {
+        const bool different = lhs.m_it != rhs.m_it;
+        if (!different) {
+            lhs.m_timer.mark_traversed();
+        }
+        return different;
+    }
+    friend bool operator==(const timed_iterator& lhs, const timed_iterator& rhs) { return !(lhs != rhs); }
+
+    It m_it;
+    range_timer m_timer;
+};
+
+// Compares an iterator with a sentinel of another type, like the counted end() of make_synchronized()
+template<typename It, typename S, typename = std::enable_if_t<!std::is_same<It, S>::value>>
+bool operator!=(const timed_iterator<It>& lhs, const timed_iterator<S>& rhs) {
+    const bool different = lhs.m_it != rhs.m_it;
+    if (!different) {
+        lhs.m_timer.mark_traversed();
+        rhs.m_timer.mark_traversed();
+    }
+    return different;
+}
+template<typename It, typename S, typename = std::enable_if_t<!std::is_same<It, S>::value>>
+bool operator==(const timed_iterator<It>& lhs, const timed_iterator<S>& rhs) { return !(lhs != rhs); }
+
+template<typename It>
+timed_iterator<It> timed_begin(It it, range_call_site site) { return {std::move(it), site}; }
+template<typename It>
+timed_iterator<It> timed_end(It it) { return {std::move(it)}; }
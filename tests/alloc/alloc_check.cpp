@@ -0,0 +1,217 @@
+// Allocation checks: counts the heap allocations of loops over the helpers, and fails when a loop exceeds its budget
+//
+// Global operator new and delete are replaced, so every allocation through new, including the std containers' allocators,
+// is counted. Direct calls to malloc() are not, which doesn't matter for the helpers, as they never call it.
+//
+// Usage: range_utils_alloc_check [case], where the case name selects a single check. Returns 1 when any check is over budget.
+
+#include "qt_like_containers.h"
+
+#include "range_utils.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::atomic<std::size_t> allocationCount{0};
+std::atomic<std::size_t> allocatedBytes{0};
+
+void* counted_allocate(std::size_t size, std::size_t alignment = 0) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    void* ptr = nullptr;
+    if (alignment > alignof(std::max_align_t)) {
+        if (posix_memalign(&ptr, alignment, size > 0 ? size : 1) != 0) {
+            ptr = nullptr;
+        }
+    } else {
+        ptr = std::malloc(size > 0 ? size : 1);
+    }
+    return ptr;
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    if (void* ptr = counted_allocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return counted_allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return counted_allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* ptr = counted_allocate(size, static_cast<std::size_t>(alignment))) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+namespace {
+
+constexpr int Iterations = 100;
+constexpr int Elements = 1000;
+
+template<typename T>
+void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct check_result {
+    double m_allocations; // Per iteration
+    double m_bytes;       // Per iteration
+};
+
+// Runs the loop, which must do a full traversal per call, and counts its allocations
+template<typename Loop>
+check_result measure(Loop&& loop) {
+    loop(); // Warm-up, eg. for the thread-local storage allocated lazily by the runtime
+    const std::size_t count = allocationCount.load();
+    const std::size_t bytes = allocatedBytes.load();
+    for (int i = 0; i < Iterations; ++i) {
+        loop();
+    }
+    return {static_cast<double>(allocationCount.load() - count) / Iterations, static_cast<double>(allocatedBytes.load() - bytes) / Iterations};
+}
+
+struct alloc_check {
+    const char* m_name;
+    double m_budget; // Allocations per iteration
+    check_result (*m_run)();
+};
+
+const std::vector<int> Ints(Elements, 1);
+const std::vector<std::string> ShortStrings(Elements, "short");
+const std::vector<std::string> LongStrings(Elements, "a string too long for the small string optimization");
+const qt_vector<double> QtDoubles(Elements, 0.5);
+
+qt_map<int, int> make_map() {
+    qt_map<int, int> map;
+    for (int i = 0; i < Elements; ++i) {
+        map.insert(i, i);
+    }
+    return map;
+}
+const qt_map<int, int> QtMap = make_map();
+
+const alloc_check Checks[] = {
+    {"reversible_vector", 0, [] {
+        return measure([] {
+            long sum = 0;
+            for (int value : make_reversible(Ints)) {
+                sum += value;
+            }
+            do_not_optimize(sum);
+        });
+    }},
+    {"reversible_qt_vector", 0, [] {
+        return measure([] {
+            double sum = 0;
+            for (double value : make_reversible(QtDoubles, false)) {
+                sum += value;
+            }
+            do_not_optimize(sum);
+        });
+    }},
+    {"reversible_moved_vector", 0, [] {
+        std::vector<std::vector<int>> copies(Iterations + 1, Ints); // Allocated before measuring, then moved into the adapter
+        return measure([&copies] {
+            long sum = 0;
+            for (int value : make_reversible(std::move(copies.back()))) {
+                sum += value;
+            }
+            copies.pop_back();
+            do_not_optimize(sum);
+        });
+    }},
+    {"synchronized_vectors", 0, [] {
+        return measure([] {
+            double sum = 0;
+            for (auto&& [value, weight, label] : make_synchronized(Ints, QtDoubles, ShortStrings)) {
+                sum += value * weight + static_cast<double>(label.size());
+            }
+            do_not_optimize(sum);
+        });
+    }},
+    // Dereferencing returns the elements by value, which copies heap-allocated strings
+    {"synchronized_long_strings", 0, [] {
+        return measure([] {
+            std::size_t size = 0;
+            for (auto&& [value, label] : make_synchronized(Ints, LongStrings)) {
+                size += static_cast<std::size_t>(value) + label.size();
+            }
+            do_not_optimize(size);
+        });
+    }},
+    {"synchronized_split", 0, [] {
+        return measure([] {
+            const auto halves = make_synchronized(Ints, QtDoubles).split();
+            double sum = 0;
+            for (auto&& [value, weight] : halves.second) {
+                sum += value * weight;
+            }
+            do_not_optimize(sum);
+        });
+    }},
+    {"keyval_qt_map", 0, [] {
+        return measure([] {
+            long sum = 0;
+            for (auto [key, value] : make_keyval(QtMap)) {
+                sum += key + value;
+            }
+            do_not_optimize(sum);
+        });
+    }},
+    {"keyval_moved_qt_map", 0, [] {
+        std::vector<qt_map<int, int>> maps(Iterations + 1, QtMap); // Shared copies, moved into the adapter
+        return measure([&maps] {
+            long sum = 0;
+            for (auto [key, value] : make_keyval(std::move(maps.back()))) {
+                sum += key + value;
+            }
+            maps.pop_back();
+            do_not_optimize(sum);
+        });
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* selected = argc > 1 ? argv[1] : nullptr;
+    bool found = false;
+    int failures = 0;
+    std::printf("%-32s %14s %14s %10s\n", "check", "allocs/iter", "bytes/iter", "budget");
+    for (const alloc_check& check : Checks) {
+        if (selected && std::strcmp(selected, check.m_name) != 0) {
+            continue;
+        }
+        found = true;
+        const check_result result = check.m_run();
+        const bool overBudget = result.m_allocations > check.m_budget;
+        failures += overBudget ? 1 : 0;
+        std::printf("%-32s %14.2f %14.1f %10.2f%s\n", check.m_name, result.m_allocations, result.m_bytes, check.m_budget, overBudget ? "  OVER BUDGET" : "");
+    }
+    if (!found) {
+        std::fprintf(stderr, "Unknown check %s\n", selected);
+        return 2;
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+# Checks the generated assembly of one function in codegen_loops.cpp
+#
+# Usage: cmake -DASM_FILE=<file.s> -DFUNCTION=<name> -DCHECKS=<check>[;<check>...] -P check_codegen.cmake
+#
+# Checks, for x86-64 assembly in AT&T syntax as generated by GCC and Clang:
+#   no_calls:          the function calls nothing, ie. every helper has been inlined
+#   branchless_loops:  the only jump in the body of each loop is its back-edge (loops are found as backward jumps)
+#   vectorized:        at least one loop body uses packed SIMD arithmetic
+
+cmake_minimum_required(VERSION 3.14)
+
+foreach(var ASM_FILE FUNCTION CHECKS)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "${var} is not defined")
+    endif()
+endforeach()
+
+file(STRINGS "${ASM_FILE}" lines)
+
+# Extract the instructions and labels of the function, up to its .size directive
+set(inFunction OFF)
+set(instructions)
+set(index 0)
+foreach(line IN LISTS lines)
+    if(NOT inFunction)
+        if(line MATCHES "^_?${FUNCTION}:")
+            set(inFunction ON)
+        endif()
+        continue()
+    endif()
+    if(line MATCHES "^[ \t]*\\.size[ \t]+_?${FUNCTION},")
+        break()
+    endif()
+    if(line MATCHES "^(\\.?L[A-Za-z0-9_]+):")
+        set(label_${CMAKE_MATCH_1} ${index})
+    elseif(line MATCHES "^[ \t]+[a-z]" AND NOT line MATCHES "^[ \t]+\\.")
+        string(STRIP "${line}" line)
+        list(APPEND instructions "${line}")
+        math(EXPR index "${index} + 1")
+    endif()
+endforeach()
+if(NOT instructions)
+    message(FATAL_ERROR "${FUNCTION} not found in ${ASM_FILE}")
+endif()
+
+# Loops are [target, jump] spans of the conditional jumps to a label at or before the jump, since optimized loops are
+# rotated to end with their exit test (unconditional backward jumps are usually shared tails, like epilogues)
+set(loops)
+set(index 0)
+foreach(instruction IN LISTS instructions)
+    if(instruction MATCHES "^j[a-z]+[ \t]+(\\.?L[A-Za-z0-9_]+)$" AND NOT instruction MATCHES "^jmp")
+        string(REGEX REPLACE "^j[a-z]+[ \t]+" "" target "${instruction}")
+        if(DEFINED label_${target} AND label_${target} LESS_EQUAL index)
+            list(APPEND loops "${label_${target}}-${index}")
+        endif()
+    endif()
+    math(EXPR index "${index} + 1")
+endforeach()
+
+set(failures)
+foreach(check IN LISTS CHECKS)
+    if(check STREQUAL "no_calls")
+        foreach(instruction IN LISTS instructions)
+            if(instruction MATCHES "^call" OR instruction MATCHES "^jmp[ \t]+[*_a-zA-Z]")
+                list(APPEND failures "call in ${FUNCTION}: ${instruction}")
+            endif()
+        endforeach()
+    elseif(check STREQUAL "branchless_loops" OR check STREQUAL "vectorized")
+        if(NOT loops)
+            list(APPEND failures "no loop found in ${FUNCTION}")
+        endif()
+        set(packedArithmetic OFF)
+        foreach(loop IN LISTS loops)
+            string(REPLACE "-" ";" loop "${loop}")
+            list(GET loop 0 first)
+            list(GET loop 1 last)
+            foreach(i RANGE ${first} ${last})
+                list(GET instructions ${i} instruction)
+                if(check STREQUAL "branchless_loops" AND i LESS last AND instruction MATCHES "^j")
+                    list(APPEND failures "branch in the loop at instructions ${first}-${last} of ${FUNCTION}: ${instruction}")
+                endif()
+                if(instruction MATCHES "^v?((add|sub|mul|div|fn?m(add|sub)[0-9]*)p[sd]|p(add|sub|mul|madd)[a-z]*)[ \t]")
+                    set(packedArithmetic ON)
+                endif()
+            endforeach()
+        endforeach()
+        if(check STREQUAL "vectorized" AND NOT packedArithmetic)
+            list(APPEND failures "no loop of ${FUNCTION} is vectorized")
+        endif()
+    else()
+        message(FATAL_ERROR "Unknown check ${check}")
+    endif()
+endforeach()
+
+if(failures)
+    list(JOIN failures "\n  " failures)
+    message(FATAL_ERROR "${ASM_FILE}:\n  ${failures}")
+endif()
+list(LENGTH loops loopCount)
+message(STATUS "${FUNCTION}: ${CHECKS} passed (${loopCount} loops)")
@@ -0,0 +1,89 @@
+// Representative hot loops for the codegen checks (see check_codegen.cmake)
+//
+// Each helper loop has a hand-written raw equivalent, which is checked too: when a raw loop fails a check,
+// the toolchain can't generate the expected code at all, and the failure of the helper loop is not a regression.
+// The functions are extern "C" so that their labels can be found in the generated assembly without demangling.
+
+#include "range_utils.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// Minimal stand-in for QFlatMap: sorted keys and values in separate contiguous arrays
+template<typename K, typename V>
+struct flat_map {
+    struct const_key_value_iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<const K&, const V&>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        value_type operator*() const { return {*m_key, *m_value}; }
+        const_key_value_iterator& operator++() { ++m_key; ++m_value; return *this; }
+        friend bool operator==(const const_key_value_iterator& lhs, const const_key_value_iterator& rhs) { return lhs.m_key == rhs.m_key; }
+        friend bool operator!=(const const_key_value_iterator& lhs, const const_key_value_iterator& rhs) { return lhs.m_key != rhs.m_key; }
+
+        const K* m_key;
+        const V* m_value;
+    };
+
+    int size() const { return static_cast<int>(m_keys.size()); }
+    const_key_value_iterator keyValueBegin() const { return {m_keys.data(), m_values.data()}; }
+    const_key_value_iterator keyValueEnd() const { return {m_keys.data() + m_keys.size(), m_values.data() + m_values.size()}; }
+
+    std::vector<K> m_keys;
+    std::vector<V> m_values;
+};
+
+extern "C" {
+
+void reversible_raw(std::vector<float>& values, float scale, float offset) {
+    for (auto it = values.rbegin(); it != values.rend(); ++it) {
+        *it = *it * scale + offset;
+    }
+}
+
+void reversible_helper(std::vector<float>& values, float scale, float offset) {
+    for (float& value : make_mutable_reversible(values)) {
+        value = value * scale + offset;
+    }
+}
+
+int zip_sum_raw(const std::vector<int>& a, const std::vector<int>& b, const std::vector<int>& c) {
+    int sum = 0;
+    const std::size_t size = std::min({a.size(), b.size(), c.size()});
+    for (std::size_t i = 0; i < size; ++i) {
+        sum += a[i] + b[i] + c[i];
+    }
+    return sum;
+}
+
+int zip_sum_helper(const std::vector<int>& a, const std::vector<int>& b, const std::vector<int>& c) {
+    int sum = 0;
+    for (auto&& [x, y, z] : make_synchronized(a, b, c)) {
+        sum += x + y + z;
+    }
+    return sum;
+}
+
+int keyval_raw(const flat_map<int, int>& map) {
+    int sum = 0;
+    for (std::size_t i = 0; i < map.m_keys.size(); ++i) {
+        sum += map.m_keys[i] * map.m_values[i];
+    }
+    return sum;
+}
+
+int keyval_helper(const flat_map<int, int>& map) {
+    int sum = 0;
+    for (auto [key, value] : make_keyval(map)) {
+        sum += key * value;
+    }
+    return sum;
+}
+
+}
@@ -0,0 +1,115 @@
+// Functional tests of range_utils.h: end conditions of make_synchronized(), and containers moved into the adapters
+
+#include "functional_test.h"
+
+#include "qt_like_containers.h"
+
+#include "range_utils.h"
+
+#include <deque>
+#include <forward_list>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Iterates over the zipped containers, and returns the values of the first one that were visited
+template<typename Range>
+std::vector<int> firsts(const Range& range) {
+    std::vector<int> values;
+    for (auto&& element : range) {
+        values.push_back(std::get<0>(element));
+    }
+    return values;
+}
+
+// A container that can only be moved, to check the adapters never copy the temporaries they own
+struct move_only_vector : std::vector<int> {
+    using std::vector<int>::vector;
+    move_only_vector(move_only_vector&&) = default;
+    move_only_vector& operator=(move_only_vector&&) = default;
+    move_only_vector(const move_only_vector&) = delete;
+    move_only_vector& operator=(const move_only_vector&) = delete;
+};
+
+const functional_test Tests[] = {
+    {"synchronized_counted_end", [] {
+        const std::vector<int> values{1, 2, 3, 4, 5};
+        const std::deque<std::string> labels{"1", "2", "3"};
+        const std::vector<int> empty;
+
+        // The end of sized containers is an empty sentinel, reached at the end of the shortest one, whichever comes first
+        const auto synchronized = make_synchronized(values, labels);
+        static_assert(!std::is_same<decltype(synchronized.begin()), decltype(synchronized.end())>::value, "the counted end should be a sentinel");
+        CHECK(firsts(synchronized) == std::vector<int>{1, 2, 3});
+        CHECK(firsts(make_synchronized(values, values)) == values);
+        auto it = synchronized.begin();
+        int steps = 0;
+        for (; synchronized.end() != it; ++it) {
+            ++steps;
+        }
+        CHECK(steps == 3 && it == synchronized.end() && !(it != synchronized.end()));
+
+        // Empty containers end at once, in any position
+        CHECK(firsts(make_synchronized(empty, labels)).empty());
+        CHECK(firsts(make_synchronized(values, empty, labels)).empty());
+        CHECK(firsts(make_synchronized(values, std::vector<int>())).empty());
+        CHECK(make_synchronized(empty, values).begin() == make_synchronized(empty, values).end());
+
+        // The halves of a split stop at the shortest container too
+        const auto halves = synchronized.split();
+        CHECK(halves.first.size_hint() + halves.second.size_hint() == 3);
+        std::vector<int> split = firsts(halves.first);
+        for (int value : firsts(halves.second)) {
+            split.push_back(value);
+        }
+        CHECK(split == std::vector<int>{1, 2, 3});
+
+        // Unsized containers compare each iterator with its end() instead
+        const std::forward_list<int> unsized{10, 20};
+        CHECK(firsts(make_synchronized(unsized, values)) == std::vector<int>{10, 20});
+        CHECK(firsts(make_synchronized(values, unsized)) == std::vector<int>{1, 2});
+        CHECK(firsts(make_synchronized(std::forward_list<int>(), values)).empty());
+    }},
+    {"moved_in_containers", [] {
+        // Adapters over lvalues only reference them, and are trivially copyable
+        const std::vector<int> values{1, 2, 3};
+        static_assert(std::is_trivially_copyable<decltype(make_reversible(values))>::value, "");
+        // The zipped ones hold a std::tuple, whose assignment is never trivial, but they are still copied as pointers
+        static_assert(std::is_trivially_copy_constructible<decltype(make_synchronized(values, values))>::value, "");
+
+        // Temporaries are moved in and owned, which makes the adapter move-only
+        auto reversed = make_reversible(move_only_vector{1, 2, 3});
+        static_assert(!std::is_copy_constructible<decltype(reversed)>::value, "an adapter owning its container shouldn't be copyable");
+        const auto moved = std::move(reversed);
+        std::vector<int> visited;
+        for (int value : moved) {
+            visited.push_back(value);
+        }
+        CHECK(visited == std::vector<int>{3, 2, 1});
+
+        const auto synchronized = make_synchronized(move_only_vector{4, 5}, values, move_only_vector{6, 7, 8});
+        static_assert(!std::is_copy_constructible<std::decay_t<decltype(synchronized)>>::value, "");
+        int sum = 0;
+        for (auto&& [a, b, c] : synchronized) {
+            sum += a * b * c;
+        }
+        CHECK(sum == 4 * 1 * 6 + 5 * 2 * 7);
+
+        qt_map<int, std::string> digits;
+        digits.insert(1, "one");
+        digits.insert(2, "two");
+        std::string joined;
+        for (auto keyValue : make_keyval(qt_map<int, std::string>(digits))) {
+            joined += std::to_string(keyValue.first) + keyValue.second;
+        }
+        CHECK(joined == "1one2two");
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
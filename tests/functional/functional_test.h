@@ -0,0 +1,83 @@
+#pragma once
+
+// Minimal harness shared by the functional tests: each executable holds a table of named cases, and runs the one
+// named on its command line, or all of them. A failed CHECK() throws, so a case stops at its first failure.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <unistd.h>
+
+// Not derived from the std exceptions checked by CHECK_THROWS(), so that a failed CHECK() can't pass for the expected exception
+class check_failure : public std::exception {
+public:
+    explicit check_failure(std::string message) : m_message(std::move(message)) {}
+    const char* what() const noexcept override { return m_message.c_str(); }
+
+private:
+    std::string m_message;
+};
+
+// Variadic, so that conditions with template arguments don't need extra parentheses
+#define CHECK(...) \
+    ((__VA_ARGS__) ? (void)0 : throw check_failure(std::string(__FILE__) + ":" + std::to_string(__LINE__) + ": CHECK(" #__VA_ARGS__ ") failed"))
+
+#define CHECK_THROWS(statement, exception_type) \
+    do { \
+        bool thrown = false; \
+        try { statement; } catch (const exception_type&) { thrown = true; } \
+        if (!thrown) throw check_failure(std::string(__FILE__) + ":" + std::to_string(__LINE__) + ": " #statement " didn't throw " #exception_type); \
+    } while (false)
+
+struct functional_test {
+    const char* m_name;
+    void (*m_run)();
+};
+
+// Path of a scratch file for the current case, removed when it goes out of scope
+class temp_file {
+public:
+    explicit temp_file(const std::string& name)
+        : m_path((std::filesystem::temp_directory_path() / ("range_utils_" + std::to_string(::getpid()) + "_" + name)).string()) {}
+    temp_file(const temp_file&) = delete;
+    temp_file& operator=(const temp_file&) = delete;
+    ~temp_file() { std::error_code error; std::filesystem::remove(m_path, error); }
+
+    const std::string& path() const { return m_path; }
+
+private:
+    std::string m_path;
+};
+
+// Usage: <test executable> [case]. Returns 1 when any selected case fails, and 2 for an unknown case name.
+template<std::size_t N>
+int run_functional_tests(int argc, char** argv, const functional_test (&tests)[N]) {
+    const char* selected = argc > 1 ? argv[1] : nullptr;
+    bool found = false;
+    int failures = 0;
+    for (const functional_test& test : tests) {
+        if (selected && std::strcmp(selected, test.m_name) != 0) {
+            continue;
+        }
+        found = true;
+        try {
+            test.m_run();
+            std::printf("%-32s ok\n", test.m_name);
+        } catch (const std::exception& e) {
+            ++failures;
+            std::printf("%-32s FAILED: %s\n", test.m_name, e.what());
+        }
+    }
+    if (!found) {
+        std::fprintf(stderr, "Unknown case %s\n", selected);
+        return 2;
+    }
+    return failures > 0 ? 1 : 0;
+}
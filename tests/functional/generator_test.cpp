@@ -0,0 +1,120 @@
+// Functional tests of range_utils_generator.h (C++20): iteration, recursion, exceptions, and use with the other helpers
+
+#include "functional_test.h"
+
+#include "range_utils_generator.h"
+
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+generator<int> iota(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+}
+
+generator<std::string> words() {
+    co_yield "temporary";
+    std::string lvalue = "a string too long for the small string optimization";
+    co_yield lvalue;
+}
+
+generator<int> failing_after(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield i;
+    }
+    throw std::runtime_error("generator");
+}
+
+struct node {
+    int m_value;
+    std::vector<std::unique_ptr<node>> m_children;
+};
+
+generator<const node*> walk(const node* root) {
+    co_yield root;
+    for (const auto& child : root->m_children) {
+        for (const node* descendant : walk(child.get())) {
+            co_yield descendant;
+        }
+    }
+}
+
+const functional_test Tests[] = {
+    {"iteration", [] {
+        std::vector<int> values;
+        for (int x : iota(5)) {
+            values.push_back(x);
+        }
+        CHECK(values == std::vector<int>{0, 1, 2, 3, 4});
+        for (int x : iota(0)) {
+            values.push_back(x);
+        }
+        CHECK(values.size() == 5);
+
+        std::vector<std::string> strings;
+        for (const std::string& s : words()) {
+            strings.push_back(s);
+        }
+        CHECK(strings == std::vector<std::string>{"temporary", "a string too long for the small string optimization"});
+
+        // Breaking out destroys the suspended frame
+        int count = 0;
+        for (int x : iota(1000)) {
+            if (x == 10) {
+                break;
+            }
+            ++count;
+        }
+        CHECK(count == 10);
+    }},
+    {"recursion", [] {
+        node root{1, {}};
+        root.m_children.push_back(std::make_unique<node>(node{2, {}}));
+        root.m_children.push_back(std::make_unique<node>(node{3, {}}));
+        root.m_children[0]->m_children.push_back(std::make_unique<node>(node{4, {}}));
+        std::vector<int> order;
+        for (const node* n : walk(&root)) {
+            order.push_back(n->m_value);
+        }
+        CHECK(order == std::vector<int>{1, 2, 4, 3});
+    }},
+    {"exceptions", [] {
+        int seen = 0;
+        CHECK_THROWS(for (int x : failing_after(3)) { seen += x; }, std::runtime_error);
+        CHECK(seen == 3);
+        CHECK_THROWS(for (int x : failing_after(0)) { (void)x; }, std::runtime_error);
+    }},
+    {"with_helpers", [] {
+        const std::vector<int> values{10, 20, 30, 40};
+        int sum = 0;
+        int pairs = 0;
+        for (auto&& [value, index] : make_synchronized(values, iota(3))) {
+            sum += value * index;
+            ++pairs;
+        }
+        CHECK(pairs == 3 && sum == 20 + 60);
+
+        std::vector<int> reversed;
+        for (int x : make_reversible(make_buffered(iota(4)))) {
+            reversed.push_back(x);
+        }
+        CHECK(reversed == std::vector<int>{3, 2, 1, 0});
+
+        const std::list<int> list{1, 2};
+        pairs = 0;
+        for (auto&& [fromList, generated] : make_synchronized(list, iota(5))) {
+            pairs += fromList == generated + 1;
+        }
+        CHECK(pairs == 2);
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
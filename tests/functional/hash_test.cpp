@@ -0,0 +1,171 @@
+// Functional tests of range_utils_hash.h and range_utils_arena.h: parallel aggregation checked against std::map,
+// hash partitioning, and arena allocation
+
+#include "functional_test.h"
+
+#include "range_utils_arena.h"
+#include "range_utils_hash.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct order {
+    int m_customer;
+    double m_amount;
+};
+
+std::vector<order> make_orders(int count, int customers) {
+    std::vector<order> orders(static_cast<std::size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        orders[static_cast<std::size_t>(i)] = {static_cast<int>((i * 7919u) % static_cast<unsigned>(customers)), double(i % 13)};
+    }
+    return orders;
+}
+
+const functional_test Tests[] = {
+    {"flat_hash_map", [] {
+        flat_hash_map<std::string, int> map(2);
+        for (int i = 0; i < 1000; ++i) {
+            const std::string key = std::to_string(i % 300);
+            auto inserted = map.try_emplace_hashed(hash_key(key), key);
+            CHECK(inserted.second == (i < 300));
+            *inserted.first += 1;
+        }
+        CHECK(map.size() == 300);
+        CHECK(*map.find("7") == 4 && *map.find("299") == 3);
+        CHECK(map.find("300") == nullptr);
+        std::size_t count = 0;
+        int total = 0;
+        for (auto keyValue : make_keyval(map)) {
+            ++count;
+            total += keyValue.second;
+        }
+        CHECK(count == 300 && total == 1000);
+        CHECK(flat_hash_map<int, int>().empty());
+    }},
+    {"aggregate_by", [] {
+        work_stealing_pool pool(4);
+        const std::vector<order> orders = make_orders(200000, 10007);
+        std::map<int, double> sums;
+        std::map<int, std::size_t> counts;
+        std::map<int, double> maxima;
+        for (const order& o : orders) {
+            sums[o.m_customer] += o.m_amount;
+            ++counts[o.m_customer];
+            maxima[o.m_customer] = std::max(maxima[o.m_customer], o.m_amount);
+        }
+        auto customer = [](const order& o) { return o.m_customer; };
+        auto amount = [](const order& o) { return o.m_amount; };
+        auto view = make_reversible(orders);
+
+        const auto totals = aggregate_by(view, customer, amount, sum_aggregate(), 0, pool);
+        CHECK(totals.size() == sums.size());
+        long mismatches = 0;
+        for (auto keyValue : make_keyval(totals)) {
+            mismatches += sums.at(keyValue.first) != keyValue.second;
+        }
+        CHECK(mismatches == 0);
+        CHECK(*totals.find(5) == sums.at(5));
+        CHECK(totals.find(-1) == nullptr);
+
+        const auto orderCounts = aggregate_by(view, customer, amount, count_aggregate(), 0, pool);
+        for (auto keyValue : make_keyval(orderCounts)) {
+            mismatches += counts.at(keyValue.first) != keyValue.second;
+        }
+        const auto largest = aggregate_by(view, customer, amount, make_aggregate([](double a, double b) { return std::max(a, b); }), 0, pool);
+        for (auto keyValue : make_keyval(largest)) {
+            mismatches += maxima.at(keyValue.first) != keyValue.second;
+        }
+        CHECK(mismatches == 0);
+
+        const std::vector<int> empty;
+        CHECK(aggregate_by(make_reversible(empty), [](int x) { return x; }, [](int x) { return x; }, min_aggregate(), 0, pool).size() == 0);
+    }},
+    {"make_partitioned", [] {
+        const std::vector<order> orders = make_orders(100000, 1003);
+        for (std::size_t fanout : {std::size_t(1), std::size_t(3), std::size_t(64)}) {
+            const auto partitions = make_partitioned(orders, [](const order& o) { return o.m_customer; }, fanout);
+            CHECK(partitions.size() == fanout);
+            std::size_t total = 0;
+            long misplaced = 0;
+            for (std::size_t p = 0; p < partitions.size(); ++p) {
+                total += partitions[p].size();
+                for (const order& o : partitions[p]) {
+                    misplaced += partitions.partition_of(hash_key(o.m_customer)) != p;
+                }
+            }
+            CHECK(total == orders.size());
+            CHECK(misplaced == 0);
+        }
+
+        // Any key function, including standard function objects, and views as input
+        std::vector<int> values(1000);
+        for (int i = 0; i < 1000; ++i) {
+            values[static_cast<std::size_t>(i)] = i;
+        }
+        const auto negated = make_partitioned(make_reversible(values), std::negate<int>(), 8);
+        std::size_t total = 0;
+        for (const auto& partition : negated) {
+            total += partition.size();
+        }
+        CHECK(negated.size() == 8 && total == 1000);
+    }},
+    {"arena", [] {
+        monotonic_arena arena(16);
+        void* small = arena.allocate(3, 1);
+        void* aligned = arena.allocate(64, 64);
+        CHECK(small != aligned);
+        CHECK(reinterpret_cast<std::uintptr_t>(aligned) % 64 == 0);
+        void* large = arena.allocate(1 << 20);
+        CHECK(large != nullptr && arena.capacity() >= (1 << 20));
+
+        // Rewinding reuses the same memory
+        const auto marker = arena.mark();
+        void* first = arena.allocate(100);
+        arena.rewind(marker);
+        CHECK(arena.allocate(100) == first);
+        const std::size_t capacity = arena.capacity();
+        arena.release();
+        arena.allocate(1000);
+        CHECK(arena.capacity() == capacity);
+    }},
+    {"arena_containers", [] {
+        const std::vector<order> orders = make_orders(50000, 977);
+        std::vector<int> values(1000);
+        for (int i = 0; i < 1000; ++i) {
+            values[static_cast<std::size_t>(i)] = i;
+        }
+        monotonic_arena arena;
+        std::size_t capacity = 0;
+        for (int round = 0; round < 5; ++round) {
+            arena_scope scope(arena);
+            const auto partitions = make_partitioned(orders, [](const order& o) { return o.m_customer; }, 64, scope.arena());
+            std::size_t total = 0;
+            for (const auto& partition : partitions) {
+                total += partition.size();
+            }
+            CHECK(total == orders.size());
+            const auto buffered = make_buffered(make_reversible(values), scope.arena());
+            CHECK(buffered.size() == 1000 && buffered.front() == 999 && buffered.back() == 0);
+            // The scope gives the memory back at the end of each round, so the arena stops growing
+            CHECK(round < 2 || arena.capacity() == capacity);
+            capacity = arena.capacity();
+        }
+
+        arena_scope scope;
+        std::vector<std::string, arena_allocator<std::string>> strings;
+        strings.push_back("a string too long for the small string optimization");
+        CHECK(strings[0] == "a string too long for the small string optimization");
+        CHECK(&strings.get_allocator().arena() == &monotonic_arena::thread_default());
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
@@ -0,0 +1,99 @@
+// Functional tests of the instrumentation of range_utils.h: the operations counted per adapter, and range_counters_scope
+
+#define RANGE_UTILS_INSTRUMENTATION
+
+#include "functional_test.h"
+
+#include "qt_like_containers.h"
+
+#include "range_utils.h"
+
+#include <forward_list>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+const functional_test Tests[] = {
+    {"synchronized_counters", [] {
+        const std::vector<int> values{1, 2, 3, 4, 5};
+        const std::vector<double> weights{0.5, 1.5, 2.5};
+        range_counters_scope scope("synchronized", weights.size());
+        double sum = 0;
+        for (auto&& [value, weight] : make_synchronized(values, weights)) {
+            sum += value * weight;
+        }
+        CHECK(sum == 0.5 + 3 + 7.5);
+        const range_counters counters = scope.counters();
+        // One dereference, increment and copy per container and element, and a single compare per end test
+        CHECK(counters.m_dereferences == 2 * 3 && counters.m_increments == 2 * 3 && counters.m_elementCopies == 2 * 3);
+        CHECK(counters.m_comparisons == 3 + 1);
+        CHECK(counters.m_containerReferences == 2 && counters.m_containerMoves == 0);
+
+        // Unsized containers compare each iterator with its end(), until one of them is reached
+        const std::forward_list<int> unsized{1, 2, 3};
+        range_counters_scope unsizedScope("unsized", 3);
+        for (auto&& element : make_synchronized(unsized, values)) {
+            (void)element;
+        }
+        CHECK(unsizedScope.counters().m_comparisons == 2 * 3 + 1);
+    }},
+    {"reversible_and_keyval_counters", [] {
+        const std::vector<std::string> labels{"a", "b", "c", "d"};
+        range_counters_scope scope("reversible", labels.size());
+        std::string joined;
+        for (const std::string& label : make_reversible(labels)) {
+            joined += label;
+        }
+        CHECK(joined == "dcba");
+        range_counters counters = scope.counters();
+        CHECK(counters.m_dereferences == 4 && counters.m_increments == 4 && counters.m_comparisons == 4 + 1);
+        CHECK(counters.m_elementCopies == 0); // The elements are returned by reference
+        CHECK(counters.m_containerReferences == 1 && counters.m_containerMoves == 0);
+
+        // Temporaries are counted as moved in
+        range_counters_scope movedScope("moved", 2);
+        for (int value : make_reversible(std::vector<int>{1, 2})) {
+            (void)value;
+        }
+        CHECK(movedScope.counters().m_containerMoves == 1 && movedScope.counters().m_containerReferences == 0);
+
+        // make_keyval() returns the iterators of the container, wrapped to count their operations
+        qt_map<int, std::string> digits;
+        digits.insert(1, "one");
+        digits.insert(2, "two");
+        range_counters_scope keyvalScope("keyval", 2);
+        for (auto keyValue : make_keyval(digits)) {
+            (void)keyValue;
+        }
+        counters = keyvalScope.counters();
+        CHECK(counters.m_dereferences == 2 && counters.m_increments == 2 && counters.m_comparisons == 2 + 1);
+    }},
+    {"per_thread_counters", [] {
+        // The counters are per thread, and a scope only sees the operations of its own thread since its construction
+        const std::vector<int> values(1000, 1);
+        range_counters_scope scope("outer");
+        std::thread([&values] {
+            long sum = 0;
+            for (int value : make_reversible(values)) {
+                sum += value;
+            }
+            (void)sum;
+        }).join();
+        CHECK(scope.counters().m_dereferences == 0);
+        for (int value : make_reversible(values, false)) {
+            (void)value;
+        }
+        {
+            range_counters_scope inner("inner");
+            CHECK(inner.counters().m_dereferences == 0);
+        }
+        CHECK(scope.counters().m_dereferences == 1000);
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
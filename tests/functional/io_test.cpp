@@ -0,0 +1,156 @@
+// Functional tests of range_utils_io.h: mapped files, and block reads through io_uring checked against the pread() fallback
+
+#include "functional_test.h"
+
+#include "range_utils_io.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+// Deterministic content of the given size, not aligned on the block size
+std::string make_content(std::size_t size) {
+    std::string content(size, '\0');
+    std::uint32_t state = 12345;
+    for (char& c : content) {
+        state = state * 1664525u + 1013904223u;
+        c = static_cast<char>(state >> 24);
+    }
+    return content;
+}
+
+void write_file(const std::string& path, const std::string& content) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+// Reads the whole file block by block, checking the offsets are contiguous
+std::string read_blocks(const std::string& path, file_read_options options, bool& usedIoUring) {
+    std::string result;
+    auto blocks = make_file_blocks(path, options);
+    usedIoUring = blocks.uses_io_uring();
+    for (const file_block& block : blocks) {
+        CHECK(block.offset == result.size());
+        CHECK(block.size > 0);
+        result.append(block.data, block.size);
+    }
+    return result;
+}
+
+struct tick {
+    long m_time;
+    double m_price;
+    int m_volume;
+    int m_flags;
+};
+
+const functional_test Tests[] = {
+    {"mapped_file", [] {
+        temp_file file("mapped.bin");
+        const std::string content = make_content(3 * 4096 + 17);
+        write_file(file.path(), content);
+        const mapped_file mapped(file.path());
+        CHECK(mapped.size() == content.size());
+        CHECK(std::string(mapped.data(), mapped.size()) == content);
+
+        mapped_file moved(file.path(), false);
+        mapped_file target = std::move(moved);
+        CHECK(moved.data() == nullptr && moved.size() == 0);
+        CHECK(std::string(target.data(), target.size()) == content);
+
+        temp_file empty("mapped_empty.bin");
+        write_file(empty.path(), std::string());
+        const mapped_file emptyMapped(empty.path());
+        CHECK(emptyMapped.size() == 0 && emptyMapped.data() == nullptr);
+
+        CHECK_THROWS(mapped_file(file.path() + ".missing"), std::system_error);
+    }},
+    {"io_uring_matches_pread", [] {
+        temp_file file("blocks.bin");
+        const std::string content = make_content(5 * 1000 * 1000 + 123);
+        write_file(file.path(), content);
+        for (std::size_t blockSize : {std::size_t(1), std::size_t(100000), std::size_t(1) << 20, std::size_t(8) << 20}) {
+            for (unsigned readAhead : {0u, 1u, 4u}) {
+                file_read_options options;
+                options.blockSize = blockSize;
+                options.readAhead = readAhead;
+                bool usedIoUring = true;
+                options.useIoUring = false;
+                const std::string fallback = read_blocks(file.path(), options, usedIoUring);
+                CHECK(!usedIoUring);
+                CHECK(fallback == content);
+                // Without io_uring support in the kernel or the headers, this goes through the fallback as well
+                options.useIoUring = true;
+                const std::string uring = read_blocks(file.path(), options, usedIoUring);
+                CHECK(uring == fallback);
+            }
+        }
+    }},
+    {"blocks_edge_cases", [] {
+        temp_file file("blocks_small.bin");
+        for (std::size_t size : {std::size_t(0), std::size_t(1), std::size_t(4096), std::size_t(4097)}) {
+            const std::string content = make_content(size);
+            write_file(file.path(), content);
+            for (bool useIoUring : {false, true}) {
+                file_read_options options;
+                options.blockSize = 4096;
+                options.useIoUring = useIoUring;
+                bool usedIoUring = false;
+                CHECK(read_blocks(file.path(), options, usedIoUring) == content);
+            }
+        }
+
+        // Breaking out of the loop with reads in flight
+        write_file(file.path(), make_content(1 << 20));
+        for (bool useIoUring : {false, true}) {
+            file_read_options options;
+            options.blockSize = 4096;
+            options.useIoUring = useIoUring;
+            int count = 0;
+            for (const file_block& block : make_file_blocks(file.path(), options)) {
+                (void)block;
+                if (++count == 3) {
+                    break;
+                }
+            }
+            CHECK(count == 3);
+        }
+
+        CHECK_THROWS(make_file_blocks(file.path() + ".missing"), std::system_error);
+    }},
+    {"records", [] {
+        temp_file file("ticks.bin");
+        std::vector<tick> ticks;
+        for (long i = 0; i < 10000; ++i) {
+            ticks.push_back({i, i * 0.5, int(i % 100), 0});
+        }
+        write_file(file.path(), std::string(reinterpret_cast<const char*>(ticks.data()), ticks.size() * sizeof(tick)));
+
+        auto records = make_records<tick>(file.path());
+        CHECK(records.size() == ticks.size());
+        CHECK(records[0].m_time == 0 && records.end()[-1].m_time == 9999);
+        long sum = 0;
+        for (const tick& t : records) {
+            sum += t.m_volume;
+        }
+        CHECK(sum == 100 * (99 * 100 / 2));
+        long expected = 9999;
+        bool reversed = true;
+        for (const tick& t : make_reversible(make_records<tick>(file.path()))) {
+            reversed = reversed && t.m_time == expected--;
+        }
+        CHECK(reversed && expected == -1);
+
+        write_file(file.path(), "abc");
+        CHECK_THROWS(make_records<tick>(file.path()), std::runtime_error);
+        CHECK_THROWS(make_records<tick>(file.path() + ".missing"), std::system_error);
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
@@ -0,0 +1,160 @@
+// Functional tests of range_utils_output.h: text and binary formats, and file output with every combination of
+// background writes and direct I/O, read back through range_utils_io.h
+
+#include "functional_test.h"
+
+#include "qt_like_containers.h"
+
+#include "range_utils_io.h"
+#include "range_utils_output.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+
+namespace {
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+const functional_test Tests[] = {
+    {"text_format", [] {
+        const std::vector<int> ints{1, -2, 3};
+        const std::vector<double> doubles{0.5, 1.25, -3};
+        const std::vector<std::string> strings{"x", "yy", "zzz"};
+        const bool flags[] = {true, false};
+        qt_map<std::string, long> map;
+        map.insert("k", 1);
+        map.insert("l", 2);
+
+        std::ostringstream out;
+        output_sink sink(out);
+        CHECK(write_range(make_synchronized(ints, doubles, strings), sink) == 3);
+        CHECK(write_range(ints, sink, text_format{',', ';'}) == 3);
+        CHECK(write_range(make_keyval(map), sink, text_format{'='}) == 2);
+        CHECK(write_range(flags, sink) == 2);
+        CHECK(write_range(std::vector<std::tuple<char, std::string>>{{'c', "d"}}, sink) == 1);
+        sink.close();
+        CHECK(out.str() == "1\t0.5\tx\n-2\t1.25\tyy\n3\t-3\tzzz\n1;-2;3;k=1\nl=2\n1\n0\nc\td\n");
+    }},
+    {"binary_format", [] {
+        const std::vector<int> ints{1, 2};
+        const std::vector<double> doubles{0.5, 1.5};
+        std::ostringstream out;
+        {
+            output_sink sink(out);
+            write_range(make_synchronized(ints, doubles), sink, binary_format());
+            write_range(std::vector<std::tuple<short, char>>{{7, 'a'}}, sink, binary_format());
+        } // Closed by the destructor
+        const std::string bytes = out.str();
+        CHECK(bytes.size() == 2 * (sizeof(int) + sizeof(double)) + sizeof(short) + sizeof(char));
+        double second = 0;
+        std::memcpy(&second, bytes.data() + sizeof(int) + sizeof(double) + sizeof(int), sizeof(double));
+        CHECK(second == 1.5);
+        CHECK(bytes.back() == 'a');
+    }},
+    {"file_options", [] {
+        temp_file binary("output.bin");
+        temp_file text("output.txt");
+        std::vector<long> values(100003);
+        std::string expectedText;
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            values[i] = static_cast<long>(i * 7919 % 100000) - 5000;
+            expectedText += std::to_string(values[i]) + '\n';
+        }
+        for (bool background : {false, true}) {
+            for (bool directIo : {false, true}) {
+                for (std::size_t bufferSize : {std::size_t(1), std::size_t(4096), std::size_t(100000)}) {
+                    file_write_options options;
+                    options.background = background;
+                    options.directIo = directIo;
+                    options.bufferSize = bufferSize;
+                    {
+                        output_sink sink(binary.path(), options);
+                        write_range(values, sink, binary_format());
+                        sink.close();
+                    }
+                    const auto records = make_records<long>(binary.path());
+                    CHECK(records.size() == values.size());
+                    CHECK(std::equal(records.begin(), records.end(), values.begin()));
+                    {
+                        output_sink sink(text.path(), options);
+                        write_range(values, sink);
+                        sink.close();
+                    }
+                    CHECK(read_file(text.path()) == expectedText);
+                }
+            }
+        }
+
+        // Rewriting a longer file truncates it
+        {
+            output_sink sink(text.path());
+            sink.write("abc", 3);
+            sink.close();
+        }
+        CHECK(read_file(text.path()) == "abc");
+    }},
+    {"numbers_round_trip", [] {
+        // Shortest representations that parse back to the same value, across buffer boundaries
+        std::vector<double> values;
+        for (int i = 0; i < 20000; ++i) {
+            values.push_back(i * 1.0000001 + 1e-7);
+        }
+        temp_file file("numbers.txt");
+        file_write_options options;
+        options.directIo = true;
+        options.bufferSize = 4096;
+        {
+            output_sink sink(file.path(), options);
+            write_range(values, sink);
+            sink.close();
+        }
+        std::istringstream in(read_file(file.path()));
+        std::string line;
+        std::size_t index = 0;
+        bool exact = true;
+        while (std::getline(in, line)) {
+            double value = 0;
+            exact = exact && std::from_chars(line.data(), line.data() + line.size(), value).ec == std::errc() && value == values[index++];
+        }
+        CHECK(exact && index == values.size());
+    }},
+    {"write_errors", [] {
+        CHECK_THROWS(output_sink("/nonexistent_directory/output.txt"), std::system_error);
+
+        const int fd = ::open("/dev/full", O_WRONLY);
+        if (fd < 0) {
+            return; // Not available in this environment
+        }
+        for (bool background : {false, true}) {
+            file_write_options options;
+            options.background = background;
+            options.bufferSize = 4096;
+            output_sink sink(fd, options);
+            CHECK_THROWS(
+                for (int i = 0; i < 100000; ++i) {
+                    sink.put('a');
+                }
+                sink.close(),
+                std::system_error);
+        }
+        ::close(fd);
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
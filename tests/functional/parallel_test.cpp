@@ -0,0 +1,192 @@
+// Functional tests of range_utils_parallel.h: the work-stealing pool, nested fork_join(), exception propagation,
+// and parallel_for_each() over the splittable views
+
+#include "functional_test.h"
+
+#include "qt_like_containers.h"
+
+#include "range_utils_parallel.h"
+
+#include <atomic>
+#include <forward_list>
+#include <list>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+long fibonacci(work_stealing_pool& pool, int n) {
+    if (n < 2) {
+        return n;
+    }
+    long left = 0;
+    long right = 0;
+    pool.fork_join([&] { left = fibonacci(pool, n - 1); }, [&] { right = fibonacci(pool, n - 2); });
+    return left + right;
+}
+
+// A view over a slice of a vector whose split() can't make progress, like a single line of text: it returns itself
+// and an empty half, on either side
+struct unsplittable_view {
+    std::vector<int>::const_iterator begin() const { return m_begin; }
+    std::vector<int>::const_iterator end() const { return m_end; }
+    std::size_t size_hint() const { return static_cast<std::size_t>(m_end - m_begin); }
+    std::pair<unsplittable_view, unsplittable_view> split() const {
+        const unsplittable_view empty{m_end, m_end, m_emptyFirst};
+        return m_emptyFirst ? std::make_pair(empty, *this) : std::make_pair(*this, empty);
+    }
+
+    std::vector<int>::const_iterator m_begin;
+    std::vector<int>::const_iterator m_end;
+    bool m_emptyFirst;
+};
+
+// Synchronized ranges can only be split when all their containers have a size(), which std::forward_list doesn't
+static_assert(has_split<decltype(make_synchronized(std::declval<const std::vector<int>&>(), std::declval<const std::list<int>&>()))>::value, "");
+static_assert(!has_split<decltype(make_synchronized(std::declval<const std::vector<int>&>(), std::declval<const std::forward_list<int>&>()))>::value, "");
+static_assert(has_split<unsplittable_view>::value && !has_split<std::vector<int>>::value, "");
+
+const functional_test Tests[] = {
+    {"pool_parallel_for", [] {
+        work_stealing_pool pool(4);
+        std::vector<long> values(100000);
+        std::iota(values.begin(), values.end(), 0L);
+        for (std::size_t grain : {std::size_t(0), std::size_t(1), std::size_t(1000), values.size() * 2}) {
+            std::atomic<long> sum{0};
+            std::atomic<long> chunks{0};
+            parallel_for(std::size_t(0), values.size(), grain, [&](std::size_t first, std::size_t last) {
+                CHECK(first < last);
+                long partial = 0;
+                for (std::size_t i = first; i < last; ++i) {
+                    partial += values[i];
+                }
+                sum += partial;
+                ++chunks;
+            }, pool);
+            CHECK(sum == 99999L * 100000 / 2);
+            CHECK(grain == 0 || chunks >= static_cast<long>((values.size() + grain - 1) / grain));
+        }
+        int calls = 0;
+        parallel_for(5, 5, 1, [&](int, int) { ++calls; }, pool);
+        CHECK(calls == 0);
+    }},
+    {"pool_run_from_threads", [] {
+        // Several external threads submitting to the same pool at once
+        work_stealing_pool pool(2);
+        std::atomic<long> sum{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 50; ++i) {
+                    parallel_for(0, 1000, 10, [&](int first, int last) { sum += last - first; }, pool);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        CHECK(sum == 4L * 50 * 1000);
+    }},
+    {"nested_fork_join", [] {
+        work_stealing_pool pool(4);
+        CHECK(fibonacci(pool, 20) == 6765);
+
+        // parallel_for() nested in the body of another one runs on the same workers
+        std::atomic<long> cells{0};
+        parallel_for(0, 64, 1, [&](int rowFirst, int rowLast) {
+            CHECK(pool.current_worker_index() >= 0);
+            for (int row = rowFirst; row < rowLast; ++row) {
+                parallel_for(0, 64, 4, [&](int first, int last) { cells += last - first; }, pool);
+            }
+        }, pool);
+        CHECK(cells == 64 * 64);
+        CHECK(pool.current_worker_index() == -1);
+    }},
+    {"exceptions", [] {
+        work_stealing_pool pool(4);
+        CHECK_THROWS(pool.run([] { throw std::runtime_error("run"); }), std::runtime_error);
+        CHECK_THROWS(pool.fork_join([] { throw std::runtime_error("left"); }, [] {}), std::runtime_error);
+        CHECK_THROWS(pool.fork_join([] {}, [] { throw std::logic_error("right"); }), std::logic_error);
+
+        // Both branches complete before the exception is propagated
+        std::atomic<int> completed{0};
+        CHECK_THROWS(pool.fork_join([&] { ++completed; throw std::runtime_error("left"); },
+                                    [&] { fibonacci(pool, 15); ++completed; }), std::runtime_error);
+        CHECK(completed == 2);
+
+        std::atomic<int> visited{0};
+        CHECK_THROWS(parallel_for(0, 1000, 1, [&](int first, int) { ++visited; if (first == 577) throw 42; }, pool), int);
+        CHECK(visited > 0);
+        CHECK_THROWS(parallel_for_each(make_reversible(std::vector<int>(1000, 1)), [](int) { throw std::runtime_error("each"); }, 0, pool),
+                     std::runtime_error);
+
+        // The pool is still usable afterwards
+        CHECK(fibonacci(pool, 15) == 610);
+    }},
+    {"for_each_views", [] {
+        work_stealing_pool pool(4);
+        std::vector<int> values(10000);
+        std::iota(values.begin(), values.end(), 1);
+        const std::list<int> list(values.begin(), values.begin() + 5000);
+
+        std::atomic<long> sum{0};
+        parallel_for_each(values.begin(), values.end(), [&](int value) { sum += value; }, 0, pool);
+        CHECK(sum == 10000L * 10001 / 2);
+
+        sum = 0;
+        parallel_for_each(make_reversible(values), [&](int value) { sum += value; }, 100, pool);
+        CHECK(sum == 10000L * 10001 / 2);
+
+        // Synchronized views stop at the shortest container, including when split
+        sum = 0;
+        std::atomic<int> mismatches{0};
+        parallel_for_each(make_synchronized(values, list), [&](const auto& values) {
+            mismatches += std::get<0>(values) != std::get<1>(values);
+            sum += std::get<1>(values);
+        }, 100, pool);
+        CHECK(mismatches == 0);
+        CHECK(sum == 5000L * 5001 / 2);
+
+        parallel_for_each(make_mutable_reversible(values), [](int& value) { value = -value; }, 0, pool);
+        CHECK(values.front() == -1 && values.back() == -10000);
+
+        qt_map<int, int> map;
+        for (int i = 0; i < 1000; ++i) {
+            map.insert(i, 2 * i);
+        }
+        sum = 0;
+        std::atomic<int> count{0};
+        parallel_for_each(make_keyval(map), [&](const auto& keyValue) {
+            mismatches += keyValue.second != 2 * keyValue.first;
+            sum += keyValue.second;
+            ++count;
+        }, 10, pool);
+        CHECK(mismatches == 0);
+        CHECK(count == 1000);
+        CHECK(sum == 999L * 1000);
+    }},
+    {"unsplittable_views", [] {
+        work_stealing_pool pool(4);
+        const std::vector<int> values(1000, 1);
+        for (bool emptyFirst : {false, true}) {
+            for (std::size_t grain : {std::size_t(0), std::size_t(1)}) {
+                std::atomic<int> sum{0};
+                std::atomic<int> chunks{0};
+                parallel_for_each_chunk(unsplittable_view{values.begin(), values.end(), emptyFirst}, [&](const auto& chunk) {
+                    ++chunks;
+                    for (int value : chunk) {
+                        sum += value;
+                    }
+                }, grain, pool);
+                CHECK(sum == 1000);
+                CHECK(chunks == 1);
+            }
+        }
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
@@ -0,0 +1,157 @@
+// Functional tests of range_utils_pipeline.h: ordering, breaking out of the loop, exceptions, and moving the range
+
+#include "functional_test.h"
+
+#include "range_utils_pipeline.h"
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <dlfcn.h>
+#include <pthread.h>
+
+// The sanitizers intercept pthread_create() themselves, so thread creation failures are only injected without them
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define RANGE_UTILS_TEST_THREAD_FAILURES 0
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer)
+#define RANGE_UTILS_TEST_THREAD_FAILURES 0
+#endif
+#endif
+#ifndef RANGE_UTILS_TEST_THREAD_FAILURES
+#define RANGE_UTILS_TEST_THREAD_FAILURES 1
+#endif
+
+namespace {
+// Threads left to create before pthread_create() fails, or a negative value to never fail
+std::atomic<int> threadsBeforeFailure{-1};
+} // namespace
+
+#if RANGE_UTILS_TEST_THREAD_FAILURES
+// Interposes the pthread_create() of libc, which std::thread calls
+extern "C" int pthread_create(pthread_t* thread, const pthread_attr_t* attributes, void* (*routine)(void*), void* argument) {
+    using create_function = int (*)(pthread_t*, const pthread_attr_t*, void* (*)(void*), void*);
+    static const auto create = reinterpret_cast<create_function>(dlsym(RTLD_NEXT, "pthread_create"));
+    if (threadsBeforeFailure.load() == 0) {
+        return EAGAIN;
+    }
+    if (threadsBeforeFailure.load() > 0) {
+        --threadsBeforeFailure;
+    }
+    return create(thread, attributes, routine, argument);
+}
+#endif
+
+namespace {
+
+std::vector<int> make_values(int count) {
+    std::vector<int> values(static_cast<std::size_t>(count));
+    std::iota(values.begin(), values.end(), 0);
+    return values;
+}
+
+// Throws from its begin(), so that the pipeline source fails on its own thread
+struct failing_source {
+    const int* begin() const { throw std::runtime_error("source"); }
+    const int* end() const { return nullptr; }
+};
+
+template<typename R>
+R pass_through(R range) { return range; }
+
+const functional_test Tests[] = {
+    {"stages_in_order", [] {
+        const std::vector<int> values = make_values(100000);
+        long expected = 0;
+        long count = 0;
+        bool ordered = true;
+        for (const std::string& text : make_pipelined(values, [](int x) { return long(x) * 2; }, [](long x) { return std::to_string(x); })) {
+            ordered = ordered && std::stol(text) == expected;
+            expected += 2;
+            ++count;
+        }
+        CHECK(ordered);
+        CHECK(count == 100000);
+
+        // Small batches and rings, with a moved-in source and no stage at all
+        long sum = 0;
+        for (int x : make_pipelined(pipeline_options{3, 4}, make_values(1000))) {
+            sum += x;
+        }
+        CHECK(sum == 999L * 1000 / 2);
+
+        count = 0;
+        for (int x : make_pipelined(std::vector<int>(), [](int x) { return x; })) {
+            count += x;
+        }
+        CHECK(count == 0);
+    }},
+    {"break_early", [] {
+        const std::vector<int> values = make_values(100000);
+        for (std::size_t capacity : {std::size_t(4), std::size_t(8192)}) {
+            int count = 0;
+            for (long x : make_pipelined(pipeline_options{16, capacity}, values, [](int x) { return long(x); }, [](long x) { return x + 1; })) {
+                CHECK(x == count + 1);
+                if (++count == 100) {
+                    break;
+                }
+            }
+            CHECK(count == 100);
+        }
+
+        // Destroying a range that was never iterated doesn't start any thread
+        auto unused = make_pipelined(values, [](int x) { return x; });
+        (void)unused;
+    }},
+    {"exceptions", [] {
+        const std::vector<int> values = make_values(100000);
+        int seen = 0;
+        CHECK_THROWS(for (int x : make_pipelined(values, [](int x) { if (x == 5000) throw std::runtime_error("stage"); return x; })) { CHECK(x < 5000); ++seen; },
+                     std::runtime_error);
+        CHECK(seen <= 5000);
+        CHECK_THROWS(for (long x : make_pipelined(values, [](int x) { return long(x); }, [](long x) { if (x == 99999) throw std::logic_error("last"); return x; })) { (void)x; },
+                     std::logic_error);
+        CHECK_THROWS(for (int x : make_pipelined(failing_source(), [](int x) { return x; })) { (void)x; }, std::runtime_error);
+
+        // The loop body throwing cancels and joins the stages
+        CHECK_THROWS(for (int x : make_pipelined(pipeline_options{16, 16}, values, [](int x) { return x; })) { if (x == 1000) throw std::out_of_range("body"); },
+                     std::out_of_range);
+    }},
+    {"move_while_running", [] {
+        const std::vector<int> values = make_values(100000);
+        auto range = make_pipelined(values, [](int x) { return x * 2; }, [](int x) { return long(x) + 1; });
+        auto first = range.begin(); // Starts the stage threads
+        (void)first;
+        auto moved = std::move(range);
+        auto returned = pass_through(std::move(moved));
+        long sum = 0;
+        for (long x : returned) {
+            sum += x;
+        }
+        CHECK(sum == 100000L * 99999 + 100000);
+    }},
+    {"thread_start_failure", [] {
+        const std::vector<int> values = make_values(100000);
+        auto range = make_pipelined(pipeline_options{16, 4}, values, [](int x) { return x * 2; }, [](int x) { return long(x) + 1; });
+#if RANGE_UTILS_TEST_THREAD_FAILURES
+        // The source and the first stage start and block on the full ring, then the last stage fails to start
+        threadsBeforeFailure = 2;
+        CHECK_THROWS(range.begin(), std::system_error);
+        threadsBeforeFailure = -1;
+#endif
+        // The started threads were joined, and begin() starts the pipeline again
+        long sum = 0;
+        for (long x : range) {
+            sum += x;
+        }
+        CHECK(sum == 100000L * 99999 + 100000);
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
@@ -0,0 +1,219 @@
+// Functional tests of range_utils_queue.h: MPMC and SPSC stress with several threads, and make_consuming()
+
+#include "functional_test.h"
+
+#include "range_utils_queue.h"
+
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr long Messages = 200000;
+
+// Pushes [0, Messages) split between the producers, drains it with the consumers, and checks every value was received exactly once.
+// produce() runs on the producer threads and returns the number of values the queue rejected.
+template<typename Produce>
+void check_mpmc(int producerCount, int consumerCount, std::size_t capacity, Produce&& produce) {
+    mpmc_queue<long> queue(capacity);
+    std::unique_ptr<std::atomic<int>[]> received(new std::atomic<int>[Messages]);
+    for (long i = 0; i < Messages; ++i) {
+        received[i] = 0;
+    }
+    std::atomic<int> producing{producerCount};
+    std::atomic<long> rejected{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producerCount; ++p) {
+        threads.emplace_back([&, p] {
+            rejected += produce(queue, p, producerCount);
+            if (--producing == 0) {
+                queue.close();
+            }
+        });
+    }
+    std::atomic<long> outOfRange{0};
+    for (int c = 0; c < consumerCount; ++c) {
+        threads.emplace_back([&] {
+            for (long& value : make_consuming(queue, 16)) {
+                if (value < 0 || value >= Messages) {
+                    ++outOfRange;
+                } else {
+                    received[value].fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK(rejected == 0);
+    CHECK(outOfRange == 0);
+    long missing = 0;
+    for (long i = 0; i < Messages; ++i) {
+        missing += received[i] != 1;
+    }
+    CHECK(missing == 0);
+}
+
+// Its copy throws for negative values, to check a failed bulk push doesn't leave a claimed element unpublished
+struct throwing_copy {
+    explicit throwing_copy(int value) : m_value(value) {}
+    throwing_copy(const throwing_copy& other) : m_value(other.m_value) {
+        if (m_value < 0) {
+            throw std::runtime_error("copy");
+        }
+    }
+    throwing_copy(throwing_copy&&) noexcept = default;
+    throwing_copy& operator=(const throwing_copy&) = default;
+    throwing_copy& operator=(throwing_copy&&) noexcept = default;
+
+    int m_value;
+};
+
+const functional_test Tests[] = {
+    {"mpmc_push_stress", [] {
+        check_mpmc(4, 4, 64, [](mpmc_queue<long>& queue, int producer, int producerCount) {
+            long rejected = 0;
+            for (long i = producer; i < Messages; i += producerCount) {
+                rejected += !queue.push(i);
+            }
+            return rejected;
+        });
+    }},
+    {"mpmc_bulk_stress", [] {
+        check_mpmc(3, 2, 256, [](mpmc_queue<long>& queue, int producer, int producerCount) {
+            std::vector<long> batch;
+            for (long i = producer; i < Messages;) {
+                batch.clear();
+                for (; i < Messages && batch.size() < 37; i += producerCount) {
+                    batch.push_back(i);
+                }
+                spin_backoff backoff;
+                for (std::size_t pushed = 0; pushed < batch.size();) {
+                    const std::size_t count = queue.try_push_bulk(batch.begin() + static_cast<std::ptrdiff_t>(pushed), batch.size() - pushed);
+                    pushed += count;
+                    if (count == 0) {
+                        backoff.pause();
+                    }
+                }
+            }
+            return 0L;
+        });
+    }},
+    {"mpmc_single_threaded", [] {
+        mpmc_queue<std::string> queue(3);
+        CHECK(queue.capacity() == 4);
+        for (int i = 0; i < 4; ++i) {
+            CHECK(queue.try_push(std::string(40, char('a' + i))));
+        }
+        CHECK(!queue.try_push("full"));
+        std::string value;
+        CHECK(queue.try_pop(value) && value == std::string(40, 'a'));
+        CHECK(queue.try_push("e"));
+        queue.close();
+        CHECK(!queue.push("closed"));
+        std::string all;
+        for (std::string& s : make_consuming(queue, 2)) {
+            all += s.substr(0, 1);
+        }
+        CHECK(all == "bcde");
+        CHECK(!queue.try_pop(value));
+
+        // Elements left in the queue are destroyed with it
+        mpmc_queue<std::string> leftover(8);
+        leftover.push(std::string(100, 'x'));
+    }},
+    {"consuming_batch_size_zero", [] {
+        mpmc_queue<long> queue(8);
+        for (long i = 0; i < 5; ++i) {
+            queue.push(i);
+        }
+        queue.close();
+        long sum = 0;
+        for (long value : make_consuming(queue, 0)) {
+            sum += value;
+        }
+        CHECK(sum == 10);
+    }},
+    {"throwing_bulk_push", [] {
+        const throwing_copy values[] = {throwing_copy(1), throwing_copy(-1), throwing_copy(3)};
+        mpmc_queue<throwing_copy> queue(8);
+        CHECK_THROWS(queue.try_push_bulk(std::begin(values), 3), std::runtime_error);
+        CHECK(queue.try_push_bulk(std::begin(values) + 2, 1) == 1);
+        queue.close();
+        int sum = 0;
+        for (throwing_copy& value : make_consuming(queue)) {
+            sum += value.m_value;
+        }
+        CHECK(sum == 1 + 3);
+
+        spsc_ring<throwing_copy> ring(8);
+        CHECK_THROWS(ring.try_push_bulk(std::begin(values), 3), std::runtime_error);
+        std::vector<throwing_copy> popped;
+        auto out = std::back_inserter(popped);
+        CHECK(ring.try_pop_bulk(out, 8) == 1 && popped[0].m_value == 1);
+    }},
+    {"spsc_stress", [] {
+        spsc_ring<long> ring(128);
+        std::thread producer([&] {
+            std::vector<long> batch;
+            for (long i = 0; i < Messages;) {
+                batch.clear();
+                for (; i < Messages && batch.size() < 50; ++i) {
+                    batch.push_back(i);
+                }
+                spin_backoff backoff;
+                for (std::size_t pushed = 0; pushed < batch.size();) {
+                    const std::size_t count = ring.try_push_bulk(batch.begin() + static_cast<std::ptrdiff_t>(pushed), batch.size() - pushed);
+                    pushed += count;
+                    if (count == 0) {
+                        backoff.pause();
+                    }
+                }
+            }
+            ring.close();
+        });
+        std::vector<long> received;
+        received.reserve(Messages);
+        auto out = std::back_inserter(received);
+        spin_backoff backoff;
+        for (;;) {
+            if (ring.try_pop_bulk(out, 33) > 0) {
+                backoff.reset();
+            } else if (ring.is_closed()) {
+                if (ring.try_pop_bulk(out, 33) == 0) {
+                    break;
+                }
+            } else {
+                backoff.pause();
+            }
+        }
+        producer.join();
+        CHECK(received.size() == static_cast<std::size_t>(Messages));
+        long outOfOrder = 0;
+        for (long i = 0; i < static_cast<long>(received.size()); ++i) {
+            outOfOrder += received[i] != i;
+        }
+        CHECK(outOfOrder == 0);
+    }},
+    {"spsc_strings", [] {
+        // Elements are moved out on pop, and those never popped are destroyed with the ring
+        spsc_ring<std::string> ring(4);
+        const std::string values[] = {std::string(50, 'a'), std::string(50, 'b'), "c"};
+        CHECK(ring.try_push_bulk(std::begin(values), 3) == 3);
+        CHECK(ring.try_push_bulk(std::begin(values), 3) == 1);
+        std::vector<std::string> popped;
+        auto out = std::back_inserter(popped);
+        CHECK(ring.try_pop_bulk(out, 2) == 2);
+        CHECK(popped[0] == values[0] && popped[1] == values[1]);
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
@@ -0,0 +1,96 @@
+// Functional tests of the C++20 ranges support of range_utils.h: the concepts the adapters model, and std::ranges algorithms and views over them
+
+#include "functional_test.h"
+
+#include "qt_like_containers.h"
+
+#include "range_utils.h"
+
+#include <algorithm>
+#include <forward_list>
+#include <list>
+#include <ranges>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+using reversed_vector = decltype(make_reversible(std::declval<std::vector<int>&>()));
+using reversed_list = decltype(make_reversible(std::declval<std::list<int>&>()));
+using owning_reversed = decltype(make_reversible(std::vector<int>()));
+using synchronized_vectors = decltype(make_synchronized(std::declval<std::vector<int>&>(), std::declval<const std::vector<std::string>&>()));
+using synchronized_unsized = decltype(make_synchronized(std::declval<std::forward_list<int>&>(), std::declval<std::vector<int>&>()));
+using keyval_map = decltype(make_keyval(std::declval<const qt_map<int, std::string>&>()));
+
+// make_reversible() keeps the category of the iterators of its container
+static_assert(std::ranges::random_access_range<reversed_vector> && std::ranges::sized_range<reversed_vector>);
+static_assert(std::ranges::bidirectional_range<reversed_list> && !std::ranges::random_access_range<reversed_list>);
+static_assert(std::ranges::view<reversed_vector> && std::ranges::borrowed_range<reversed_vector>);
+static_assert(std::ranges::view<owning_reversed> && !std::ranges::borrowed_range<owning_reversed>);
+
+// make_synchronized() is a forward range, only sized when all its containers are
+static_assert(std::ranges::forward_range<synchronized_vectors> && !std::ranges::bidirectional_range<synchronized_vectors>);
+static_assert(std::ranges::sized_range<synchronized_vectors> && std::ranges::borrowed_range<synchronized_vectors>);
+static_assert(std::ranges::view<synchronized_vectors> && !std::ranges::common_range<synchronized_vectors>); // The counted end is a sentinel
+static_assert(std::ranges::forward_range<synchronized_unsized> && !std::ranges::sized_range<synchronized_unsized>);
+
+static_assert(std::ranges::view<keyval_map> && std::ranges::sized_range<keyval_map> && std::ranges::borrowed_range<keyval_map>);
+
+const functional_test Tests[] = {
+    {"algorithms", [] {
+        std::vector<int> values{3, 1, 4, 1, 5, 9, 2, 6};
+        std::ranges::sort(make_mutable_reversible(values));
+        CHECK(values == std::vector<int>{9, 6, 5, 4, 3, 2, 1, 1});
+
+        // Borrowed, so the iterator into an adapter over an lvalue doesn't dangle
+        auto it = std::ranges::find(make_reversible(values), 4);
+        CHECK(it != make_reversible(values).end() && *it == 4 && it.base() == values.begin() + 4);
+        CHECK(std::ranges::size(make_reversible(values)) == values.size());
+        CHECK(std::ranges::equal(make_reversible(values, false), values));
+
+        const std::vector<std::string> labels{"a", "b", "c"};
+        const auto synchronized = make_synchronized(values, labels);
+        CHECK(std::ranges::size(synchronized) == 3 && std::ranges::distance(synchronized) == 3);
+        CHECK(std::ranges::count_if(synchronized, [](const auto& element) { return std::get<0>(element) > 5; }) == 2);
+        const auto found = std::ranges::find_if(synchronized, [](const auto& element) { return std::get<1>(element) == "c"; });
+        CHECK(found != synchronized.end() && std::get<0>(*found) == 5);
+        CHECK(std::ranges::find_if(synchronized, [](const auto& element) { return std::get<1>(element) == "d"; }) == synchronized.end());
+    }},
+    {"views", [] {
+        const std::vector<int> values{1, 2, 3, 4, 5, 6};
+        std::vector<int> evens;
+        for (int value : make_reversible(values) | std::views::filter([](int x) { return x % 2 == 0; }) | std::views::take(2)) {
+            evens.push_back(value);
+        }
+        CHECK(evens == std::vector<int>{6, 4});
+
+        // A view over a reversed view iterates forward again
+        std::vector<int> forward;
+        for (int value : make_reversible(values) | std::views::reverse) {
+            forward.push_back(value);
+        }
+        CHECK(forward == values);
+
+        const std::forward_list<int> unsized{10, 20, 30};
+        int sum = 0;
+        for (auto&& [a, b] : make_synchronized(unsized, values) | std::views::drop(1)) {
+            sum += a * b;
+        }
+        CHECK(sum == 20 * 2 + 30 * 3);
+
+        qt_map<int, std::string> digits;
+        digits.insert(1, "one");
+        digits.insert(2, "two");
+        digits.insert(3, "three");
+        std::string keys;
+        for (int key : make_keyval(digits) | std::views::keys) {
+            keys += std::to_string(key);
+        }
+        CHECK(keys == "123");
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
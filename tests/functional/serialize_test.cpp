@@ -0,0 +1,187 @@
+// Functional tests of range_utils_serialize.h: round-trips of every supported kind of value through memory and files,
+// zero-copy views, and errors on truncated or mismatched input
+
+#include "functional_test.h"
+
+#include "qt_like_containers.h"
+
+#include "range_utils_serialize.h"
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+enum class side : char { buy, sell };
+
+struct point {
+    int m_x;
+    double m_y;
+};
+
+struct alignas(64) wide {
+    int m_value;
+    char m_padding[60];
+};
+
+// Serializes the values to a std::ostream, and returns the bytes
+template<typename...Ts>
+std::string serialize_all(const Ts&...values) {
+    std::ostringstream out;
+    output_sink sink(out);
+    serial_writer writer(sink);
+    (serialize(writer, values), ...);
+    sink.close();
+    return out.str();
+}
+
+template<typename T>
+T round_trip(const T& value) {
+    const std::string bytes = serialize_all(value);
+    serial_reader reader(bytes.data(), bytes.size());
+    T result = deserialize<T>(reader);
+    CHECK(reader.at_end());
+    return result;
+}
+
+const functional_test Tests[] = {
+    {"scalars", [] {
+        CHECK(round_trip(char(-3)) == char(-3));
+        CHECK(round_trip(std::int16_t(-12345)) == std::int16_t(-12345));
+        CHECK(round_trip(std::uint32_t(0xdeadbeef)) == 0xdeadbeef);
+        CHECK(round_trip(-(std::int64_t(1) << 40)) == -(std::int64_t(1) << 40));
+        CHECK(round_trip(1.0 / 3) == 1.0 / 3);
+        CHECK(round_trip(2.5f) == 2.5f);
+        CHECK(round_trip(true));
+        CHECK(round_trip(side::sell) == side::sell);
+        const point p = round_trip(point{3, 4.5});
+        CHECK(p.m_x == 3 && p.m_y == 4.5);
+    }},
+    {"strings_and_sequences", [] {
+        CHECK(round_trip(std::string()).empty());
+        CHECK(round_trip(std::string("a string too long for the small string optimization")) == "a string too long for the small string optimization");
+        CHECK(round_trip(std::string("nul\0inside", 10)) == std::string("nul\0inside", 10));
+        const std::vector<std::string> symbols{"AAPL", "", "MSFT"};
+        CHECK(round_trip(symbols) == symbols);
+        const std::vector<double> prices{1.5, -2.5, 1e300};
+        CHECK(round_trip(prices) == prices);
+        CHECK(round_trip(std::vector<int>()).empty());
+        const std::list<int> list{5, 6, 7};
+        CHECK(round_trip(list) == list);
+        const std::vector<std::vector<int>> nested{{1}, {}, {2, 3}};
+        CHECK(round_trip(nested) == nested);
+        const std::vector<point> points{{1, 1.0}, {2, 2.0}};
+        const std::vector<point> pointsBack = round_trip(points);
+        CHECK(pointsBack.size() == 2 && pointsBack[1].m_x == 2 && pointsBack[1].m_y == 2.0);
+    }},
+    {"maps_and_tuples", [] {
+        const std::map<std::string, double> last{{"AAPL", 1.0}, {"MSFT", 2.0}};
+        CHECK(round_trip(last) == last);
+        const std::tuple<int, std::string, side> tuple{7, "x", side::sell};
+        CHECK(round_trip(tuple) == tuple);
+        const std::pair<long, std::vector<int>> pair{-1, {1, 2}};
+        CHECK(round_trip(pair) == pair);
+
+        qt_map<int, std::string> qtMap;
+        qtMap.insert(1, "one");
+        qtMap.insert(2, "two");
+        const qt_map<int, std::string> qtMapBack = round_trip(qtMap);
+        std::map<int, std::string> entries;
+        for (auto keyValue : make_keyval(qtMapBack)) {
+            entries.emplace(keyValue.first, keyValue.second);
+        }
+        CHECK(entries == (std::map<int, std::string>{{1, "one"}, {2, "two"}}));
+    }},
+    {"fixed_size_arrays", [] {
+        const std::array<int, 3> array{4, 5, 6};
+        CHECK(round_trip(array) == array);
+        const std::array<std::string, 2> strings{"a", "b"};
+        CHECK(round_trip(strings) == strings);
+
+        const std::string bytes = serialize_all(array);
+        serial_reader reader(bytes.data(), bytes.size());
+        std::array<int, 2> wrongSize{};
+        CHECK_THROWS(deserialize(reader, wrongSize), std::runtime_error);
+    }},
+    {"alignment", [] {
+        // Over-aligned elements are padded to their alignment in the stream, so they can be read in place
+        std::vector<wide> wides(3);
+        for (int i = 0; i < 3; ++i) {
+            wides[i] = wide{};
+            wides[i].m_value = i + 10;
+        }
+        const std::string bytes = serialize_all(char(1), wides, std::int16_t(2), wides);
+        serial_reader reader(bytes.data(), bytes.size());
+        CHECK(deserialize<char>(reader) == 1);
+        const std::vector<wide> first = deserialize<std::vector<wide>>(reader);
+        CHECK(first.size() == 3 && first[2].m_value == 12);
+        CHECK(deserialize<std::int16_t>(reader) == 2);
+        const std::vector<wide> second = deserialize<std::vector<wide>>(reader);
+        CHECK(second.size() == 3 && second[0].m_value == 10);
+        CHECK(reader.at_end());
+    }},
+    {"file_views_and_columns", [] {
+        temp_file file("columns.bin");
+        const std::vector<std::string> symbols{"AAPL", "MSFT"};
+        std::vector<std::int64_t> times;
+        std::vector<double> prices;
+        for (int i = 0; i < 1000; ++i) {
+            times.push_back(i);
+            prices.push_back(i * 0.25);
+        }
+        {
+            output_sink sink(file.path());
+            serial_writer writer(sink);
+            serialize(writer, symbols);
+            serialize_columns(writer, times, prices);
+            serialize(writer, times);
+            sink.close();
+        }
+        std::vector<std::int64_t> timesBack;
+        std::vector<double> pricesBack;
+        auto read = [&] {
+            serial_reader reader(mapped_file(file.path()));
+            CHECK(deserialize<std::vector<std::string>>(reader) == symbols);
+            deserialize_columns(reader, timesBack, pricesBack);
+            auto view = read_view<std::int64_t>(reader);
+            CHECK(reader.at_end());
+            return view;
+        };
+        // The view keeps the mapping alive after the reader is gone
+        const auto view = read();
+        CHECK(timesBack == times && pricesBack == prices);
+        CHECK(view.size() == times.size());
+        double sum = 0;
+        for (auto&& [time, price] : make_synchronized(view, pricesBack)) {
+            sum += static_cast<double>(time) * price;
+        }
+        double expected = 0;
+        for (int i = 0; i < 1000; ++i) {
+            expected += i * (i * 0.25);
+        }
+        CHECK(sum == expected);
+    }},
+    {"truncated_input", [] {
+        const std::string bytes = serialize_all(std::string("hello"), std::vector<int>{1, 2, 3});
+        for (std::size_t size = 0; size < bytes.size(); ++size) {
+            serial_reader reader(bytes.data(), size);
+            CHECK_THROWS((deserialize<std::string>(reader), deserialize<std::vector<int>>(reader)), std::runtime_error);
+        }
+        // A huge element count doesn't allocate before failing
+        const char hugeCount[] = "\xff\xff\xff\xff\xff\xff\xff\x7f";
+        serial_reader reader(hugeCount, 8);
+        CHECK_THROWS(deserialize<std::vector<std::string>>(reader), std::runtime_error);
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
@@ -0,0 +1,212 @@
+// Functional tests of range_utils_snapshot.h: epoch-based reclamation of retired versions, and consistent snapshots
+// read concurrently with updates
+
+#include "functional_test.h"
+
+#include "range_utils_snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<int> aliveCount{0};
+std::atomic<int> copyCount{0};
+
+// Counts its live instances, to check when retired versions are deleted, and its copies
+struct tracked {
+    tracked() { ++aliveCount; }
+    tracked(const tracked& other) : m_value(other.m_value) { ++aliveCount; ++copyCount; }
+    tracked& operator=(const tracked&) = default;
+    ~tracked() { --aliveCount; }
+
+    long m_value = 0;
+};
+
+const functional_test Tests[] = {
+    {"versioned_reclaim", [] {
+        {
+            versioned<tracked> value;
+            auto snapshot = value.read();
+            value.update([](tracked& v) { ++v.m_value; });
+            value.update([](tracked& v) { ++v.m_value; });
+            CHECK(value.read()->m_value == 2);
+            CHECK(snapshot->m_value == 0);
+            CHECK(aliveCount == 3); // The pinned version and the one retired after it can't be reclaimed yet
+            { auto released = std::move(snapshot); }
+            CHECK(aliveCount == 1); // The last reader reclaimed them
+            value.store(tracked());
+            CHECK(value.read()->m_value == 0);
+        }
+        CHECK(aliveCount == 0);
+    }},
+    {"snapshot_moved_to_thread", [] {
+        {
+            versioned<tracked> value;
+            auto snapshot = value.read();
+            value.update([](tracked& v) { ++v.m_value; });
+            CHECK(aliveCount == 2);
+            // Released by the thread it is moved to, which never pinned it, while this thread is no longer pinned
+            std::atomic<long> seen{-1};
+            std::thread reader([&seen, moved = std::move(snapshot)] { seen = moved->m_value; });
+            reader.join();
+            CHECK(seen == 0);
+            CHECK(aliveCount == 1);
+            value.update([](tracked& v) { ++v.m_value; });
+            CHECK(aliveCount == 1);
+
+            // Moved again, and released while the thread that read it still holds another snapshot
+            auto outer = value.read();
+            std::vector<versioned<tracked>::snapshot> snapshots;
+            snapshots.push_back(value.read());
+            snapshots.push_back(std::move(snapshots.back()));
+            std::thread([&seen, moved = std::move(snapshots)] { seen = moved.back()->m_value; }).join();
+            CHECK(seen == 2);
+            value.update([](tracked& v) { ++v.m_value; });
+            CHECK(aliveCount == 2); // Only the version still pinned by outer
+        }
+        CHECK(aliveCount == 0);
+    }},
+    {"versioned_concurrent", [] {
+        {
+            versioned<std::vector<long>> value(std::vector<long>(100, 0));
+            std::atomic<bool> stop{false};
+            std::atomic<long> torn{0};
+            std::vector<std::thread> readers;
+            for (int t = 0; t < 3; ++t) {
+                readers.emplace_back([&] {
+                    while (!stop.load()) {
+                        auto snapshot = value.read();
+                        for (long x : *snapshot) {
+                            torn += x != snapshot->front();
+                        }
+                    }
+                });
+            }
+            for (int i = 1; i <= 5000; ++i) {
+                value.update([i](std::vector<long>& v) { for (long& x : v) x = i; });
+            }
+            stop = true;
+            for (std::thread& thread : readers) {
+                thread.join();
+            }
+            CHECK(torn == 0);
+            CHECK(value.read()->back() == 5000);
+        }
+        {
+            versioned<tracked> value;
+            std::atomic<bool> stop{false};
+            std::vector<std::thread> readers;
+            for (int t = 0; t < 4; ++t) {
+                readers.emplace_back([&] { while (!stop.load()) { auto snapshot = value.read(); (void)snapshot->m_value; } });
+            }
+            for (int i = 0; i < 20000; ++i) {
+                value.update([](tracked& v) { ++v.m_value; });
+            }
+            stop = true;
+            for (std::thread& thread : readers) {
+                thread.join();
+            }
+            epoch_domain::reclaim();
+            CHECK(aliveCount == 1);
+        }
+        CHECK(aliveCount == 0);
+    }},
+    {"snapshot_vector_updates", [] {
+        snapshot_vector<std::string, 4> vector;
+        std::vector<std::string> expected;
+        for (int i = 0; i < 50; ++i) {
+            vector.push_back(std::to_string(i));
+            expected.push_back(std::to_string(i));
+        }
+        const auto before = vector.read();
+        vector.update([](snapshot_vector<std::string, 4>::writer& w) {
+            w.set(5, "five");
+            w.pop_back();
+            w.push_back("last");
+        });
+        expected[5] = "five";
+        expected.back() = "last";
+        const auto after = vector.read();
+        CHECK(after.size() == expected.size());
+        CHECK(std::equal(after.begin(), after.end(), expected.begin()));
+        CHECK(std::equal(after.rbegin(), after.rend(), expected.rbegin()));
+
+        // The older snapshot is unchanged
+        CHECK(before.size() == 50 && before[5] == "5" && before[49] == "49");
+
+        // Nothing is published when the update throws
+        CHECK_THROWS(vector.update([](snapshot_vector<std::string, 4>::writer& w) { w.clear(); throw std::runtime_error("update"); }), std::runtime_error);
+        CHECK(vector.read().size() == 50);
+
+        vector.update([](snapshot_vector<std::string, 4>::writer& w) { w.clear(); });
+        CHECK(vector.read().empty());
+        CHECK(before.size() == 50);
+    }},
+    {"snapshot_vector_pop_back", [] {
+        {
+            snapshot_vector<tracked, 4> vector;
+            vector.update([](snapshot_vector<tracked, 4>::writer& w) {
+                for (int i = 0; i < 10; ++i) {
+                    w.push_back(tracked());
+                    w.set(static_cast<std::size_t>(i), tracked());
+                }
+            });
+            const auto before = vector.read();
+            copyCount = 0;
+            // Blocks of 4, 4 and 2 elements: the shared blocks only get their remaining elements copied, and none when emptied
+            vector.update([](snapshot_vector<tracked, 4>::writer& w) {
+                w.pop_back();
+                w.pop_back();
+                w.pop_back();
+                w.pop_back();
+            });
+            CHECK(copyCount == 1 + 3);
+            CHECK(vector.read().size() == 6 && before.size() == 10);
+        }
+        CHECK(aliveCount == 0);
+    }},
+    {"snapshot_vector_concurrent", [] {
+        snapshot_vector<long, 64> vector;
+        vector.update([](snapshot_vector<long, 64>::writer& w) { for (int i = 0; i < 1000; ++i) w.push_back(0); });
+        std::atomic<bool> stop{false};
+        std::atomic<long> torn{0};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t) {
+            readers.emplace_back([&] {
+                while (!stop.load()) {
+                    const auto snapshot = vector.read();
+                    const long first = snapshot[0];
+                    for (const long& x : make_reversible(snapshot)) {
+                        torn += x != first;
+                    }
+                    torn += snapshot.size() < 1000;
+                }
+            });
+        }
+        for (long generation = 1; generation <= 2000; ++generation) {
+            vector.update([generation](snapshot_vector<long, 64>::writer& w) {
+                for (std::size_t i = 0; i < w.size(); ++i) {
+                    w.set(i, generation);
+                }
+                w.push_back(generation);
+                w.pop_back();
+            });
+        }
+        stop = true;
+        for (std::thread& thread : readers) {
+            thread.join();
+        }
+        CHECK(torn == 0);
+        const auto last = vector.read();
+        CHECK(last.size() == 1000 && last[0] == 2000 && last[999] == 2000);
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
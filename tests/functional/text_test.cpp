@@ -0,0 +1,207 @@
+// Functional tests of range_utils_text.h: line and CSV edge cases (CRLF, quoted fields, missing trailing newline),
+// owned buffers, and splitting for parallel_for_each()
+
+#include "functional_test.h"
+
+#include "range_utils_parallel.h"
+#include "range_utils_text.h"
+
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> collect(const line_range& lines) {
+    std::vector<std::string> result;
+    for (std::string_view line : lines) {
+        result.emplace_back(line);
+    }
+    return result;
+}
+
+using strings = std::vector<std::string>;
+
+const functional_test Tests[] = {
+    {"lines_terminators", [] {
+        CHECK(collect(make_lines(std::string_view("a\nbb\nccc\n"))) == (strings{"a", "bb", "ccc"}));
+        CHECK(collect(make_lines(std::string_view("a\r\nbb\nccc\r\n"))) == (strings{"a", "bb", "ccc"}));
+        CHECK(collect(make_lines(std::string_view("a\nlast"))) == (strings{"a", "last"}));
+        CHECK(collect(make_lines(std::string_view("a\r\nlast\r"))) == (strings{"a", "last"}));
+        CHECK(collect(make_lines(std::string_view("\n\r\n\nx"))) == (strings{"", "", "", "x"}));
+        CHECK(collect(make_lines(std::string_view("a\rb\n"))) == (strings{"a\rb"}));
+        CHECK(collect(make_lines(std::string_view("\n"))) == (strings{""}));
+        CHECK(collect(make_lines(std::string_view(""))).empty());
+        CHECK(collect(make_lines(std::string_view("x\ny\n")).drop_first()) == (strings{"y"}));
+        CHECK(collect(make_lines(std::string_view("header")).drop_first()).empty());
+
+        // Lines longer than the 16 bytes scanned at a time, with terminators on both sides of a block boundary
+        std::string text;
+        strings expected;
+        for (int i = 0; i < 200; ++i) {
+            expected.push_back(std::string(static_cast<std::size_t>(i % 37), char('a' + i % 26)));
+            text += expected.back() + (i % 3 == 0 ? "\r\n" : "\n");
+        }
+        CHECK(collect(make_lines(text)) == expected);
+    }},
+    {"lines_owned_buffers", [] {
+        // Temporaries are moved into the range, so the lines stay valid as long as the range
+        auto lines = make_lines(std::string("short\r\nlonger than the small string buffer for sure\n"));
+        CHECK(collect(lines) == (strings{"short", "longer than the small string buffer for sure"}));
+        const auto halves = lines.split();
+        lines = make_lines(std::string_view(""));
+        strings split = collect(halves.first);
+        for (std::string& line : collect(halves.second)) {
+            split.push_back(line);
+        }
+        CHECK(split == (strings{"short", "longer than the small string buffer for sure"}));
+        CHECK(collect(make_lines(std::vector<char>{'a', '\n', 'b'})) == (strings{"a", "b"}));
+
+        temp_file file("lines.txt");
+        { std::ofstream out(file.path(), std::ios::binary); out << "first\r\nsecond\nthird"; }
+        CHECK(collect(make_lines(mapped_file(file.path()))) == (strings{"first", "second", "third"}));
+        { std::ofstream out(file.path(), std::ios::binary | std::ios::trunc); }
+        CHECK(collect(make_lines(mapped_file(file.path()))).empty());
+    }},
+    {"lines_parallel", [] {
+        std::string text;
+        long expectedBytes = 0;
+        for (int i = 0; i < 20000; ++i) {
+            const std::string line = "line number " + std::to_string(i);
+            expectedBytes += static_cast<long>(line.size());
+            text += line + (i % 3 ? "\n" : "\r\n");
+        }
+        text.pop_back(); // No trailing newline
+        std::atomic<long> count{0};
+        std::atomic<long> bytes{0};
+        std::atomic<long> carriageReturns{0};
+        parallel_for_each(make_lines(text), [&](std::string_view line) {
+            ++count;
+            bytes += static_cast<long>(line.size());
+            carriageReturns += !line.empty() && line.back() == '\r';
+        }, 100);
+        CHECK(count == 20000);
+        CHECK(bytes == expectedBytes);
+        CHECK(carriageReturns == 0);
+    }},
+    {"lines_split_long_lines", [] {
+        // A line longer than half the text leaves no boundary after the middle, so the split falls back to one before it
+        std::string text;
+        for (int i = 0; i < 10; ++i) {
+            text += "short " + std::to_string(i) + "\n";
+        }
+        text += std::string(200, 'x') + "\n";
+        const auto halves = make_lines(text).split();
+        CHECK(collect(halves.first).size() == 10 && collect(halves.second) == (strings{std::string(200, 'x')}));
+
+        // A single line can't be split, with or without a terminator
+        for (const std::string& line : {std::string(300, 'y'), std::string(300, 'y') + "\n", std::string("\n"), std::string()}) {
+            const auto single = make_lines(line).split();
+            CHECK(single.first.size_hint() == line.size() && single.second.size_hint() == 0);
+        }
+
+        for (std::size_t grain : {std::size_t(0), std::size_t(1), std::size_t(16)}) {
+            std::atomic<long> count{0};
+            std::atomic<long> bytes{0};
+            parallel_for_each(make_lines(text), [&](std::string_view line) {
+                ++count;
+                bytes += static_cast<long>(line.size());
+            }, grain);
+            CHECK(count == 11);
+            CHECK(bytes == static_cast<long>(text.size()) - 11);
+        }
+    }},
+    {"csv_quotes_and_crlf", [] {
+        const std::string text =
+            "sym,date,open,high,low,close,vol\r\n"
+            "AAPL,2024,1,2,3,4.5,100\r\n"
+            "\r\n"
+            "\"B,C\",x,,,,+2.25,7\n"
+            "\"say \"\"hi\"\"\",y,,,,1e3,-5\n"
+            "\"\",z,,,,0,0";
+        std::vector<std::tuple<std::string, double, long>> rows;
+        for (auto [symbol, close, volume] : make_csv<std::string_view, double, long>(make_lines(text), {0, 5, 6})) {
+            rows.emplace_back(std::string(symbol), close, volume);
+        }
+        CHECK(rows.size() == 4);
+        CHECK(rows[0] == std::make_tuple(std::string("AAPL"), 4.5, 100L));
+        CHECK(rows[1] == std::make_tuple(std::string("B,C"), 2.25, 7L));
+        CHECK(rows[2] == std::make_tuple(std::string("say \"\"hi\"\""), 1000.0, -5L)); // Quotes aren't unescaped
+        CHECK(rows[3] == std::make_tuple(std::string(), 0.0, 0L));
+
+        // Quoted last field, separator option and no header
+        std::vector<std::tuple<int, std::string>> others;
+        for (auto row : make_csv<int, std::string>(csv_options{';', false}, make_lines(std::string_view("1;x\r\n2;\"a;b\"")))) {
+            others.push_back(row);
+        }
+        CHECK(others.size() == 2 && std::get<1>(others[0]) == "x" && std::get<1>(others[1]) == "a;b");
+    }},
+    {"csv_columns", [] {
+        const std::string text = "a,b,c\nx,1,2.5\ny,3,4\n";
+        std::vector<std::tuple<std::string, double, std::string, int>> rows;
+        for (auto [first, second, name, number] : make_csv<std::string_view, double, std::string_view, int>(make_lines(text), {2, 2, 0, 1})) {
+            rows.emplace_back(std::string(first), second, std::string(name), number);
+        }
+        CHECK(rows.size() == 2);
+        CHECK(rows[0] == std::make_tuple(std::string("2.5"), 2.5, std::string("x"), 1));
+        CHECK(rows[1] == std::make_tuple(std::string("4"), 4.0, std::string("y"), 3));
+
+        int product = 0;
+        for (auto [a, b] : make_csv<int, int>(make_lines(std::string("a,b\n1,2\n3,4")))) {
+            product += a * b;
+        }
+        CHECK(product == 14);
+    }},
+    {"csv_errors", [] {
+        auto parse_all = [](auto&& rows) { for (auto row : rows) (void)row; };
+        CHECK_THROWS(parse_all(make_csv<int>(make_lines(std::string_view("h\nabc")))), std::invalid_argument);
+        CHECK_THROWS(parse_all(make_csv<int>(make_lines(std::string_view("h\n12x")))), std::invalid_argument);
+        CHECK_THROWS(parse_all(make_csv<int, int>(make_lines(std::string_view("h\n1")), {0, 3})), std::invalid_argument);
+        CHECK_THROWS(parse_all(make_csv<std::string>(make_lines(std::string_view("h\n\"open")))), std::invalid_argument);
+        CHECK_THROWS(parse_all(make_csv<std::string>(make_lines(std::string_view("h\n\"a\"b,c")))), std::invalid_argument);
+    }},
+    {"csv_parallel", [] {
+        std::string text = "name,value,weight\n";
+        long expected = 0;
+        for (int i = 0; i < 20000; ++i) {
+            text += "\"n," + std::to_string(i) + "\"," + std::to_string(i) + ",0.5" + (i % 2 ? "\r\n" : "\n");
+            expected += i;
+        }
+        std::atomic<long> sum{0};
+        std::atomic<long> count{0};
+        parallel_for_each(make_csv<long, double>(make_lines(text), {1, 2}), [&](const std::tuple<long, double>& row) {
+            sum += std::get<0>(row);
+            count += std::get<1>(row) == 0.5;
+        }, 100);
+        CHECK(sum == expected);
+        CHECK(count == 20000);
+    }},
+    {"csv_split_long_rows", [] {
+        // Rows are split like lines, so a row longer than half the text must not stop the split either
+        std::string text = "name,value\n";
+        for (int i = 0; i < 10; ++i) {
+            text += "n" + std::to_string(i) + "," + std::to_string(i) + "\n";
+        }
+        text += "\"" + std::string(200, 'x') + "\",100\n";
+        const auto halves = make_csv<std::string_view, int>(make_lines(text)).split();
+        CHECK(halves.first.size_hint() > 0 && halves.second.size_hint() > 0);
+        for (std::size_t grain : {std::size_t(0), std::size_t(1), std::size_t(16)}) {
+            std::atomic<long> sum{0};
+            std::atomic<long> count{0};
+            parallel_for_each(make_csv<std::string_view, int>(make_lines(text)), [&](const std::tuple<std::string_view, int>& row) {
+                sum += std::get<1>(row);
+                ++count;
+            }, grain);
+            CHECK(sum == 45 + 100);
+            CHECK(count == 11);
+        }
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }
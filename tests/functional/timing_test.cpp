@@ -0,0 +1,132 @@
+// Functional tests of the call-site timing of range_utils.h: sampling, per-site tables merged over threads, and exports
+
+#define RANGE_UTILS_TIMING
+#define RANGE_UTILS_TIMING_SAMPLE_PERIOD 4
+
+#include "functional_test.h"
+
+#include "range_utils.h"
+
+#include <cstdint>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Samples recorded at the given line of this file, merged over all the threads
+std::uint64_t samples_at(int line) {
+    for (const range_timing::site_stats& site : range_timing::snapshot()) {
+        if (site.m_file == __FILE__ && site.m_line == line) {
+            return site.m_samples;
+        }
+    }
+    return 0;
+}
+
+const functional_test Tests[] = {
+    {"sampling_per_call_site", [] {
+        range_timing::reset();
+        const std::vector<int> values{1, 2, 3};
+        const std::vector<int> empty;
+        long sum = 0;
+        // Any RANGE_UTILS_TIMING_SAMPLE_PERIOD consecutive traversals of a thread have exactly one of them timed
+        int zipLine = 0;
+        int reverseLine = 0;
+        for (int i = 0; i < 64; ++i) {
+            zipLine = __LINE__ + 1;
+            for (auto&& [a, b] : make_synchronized(values, values)) {
+                sum += a * b;
+            }
+        }
+        for (int i = 0; i < 32; ++i) {
+            reverseLine = __LINE__ + 1;
+            for (int value : make_reversible(i % 2 == 0 ? values : empty)) {
+                if (value == 2) {
+                    break; // Timed until the loop exits, whichever way
+                }
+            }
+        }
+        CHECK(sum == 64 * 14);
+        CHECK(samples_at(zipLine) == 64 / 4);
+        CHECK(samples_at(reverseLine) == 32 / 4);
+
+        // A begin() without a traversal isn't recorded
+        for (int i = 0; i < 8; ++i) {
+            (void)make_reversible(values).begin();
+        }
+        CHECK(range_timing::snapshot().size() == 2);
+
+        range_timing::reset();
+        CHECK(range_timing::snapshot().empty());
+    }},
+    {"threads_merged", [] {
+        range_timing::reset();
+        const std::vector<int> values(100, 1);
+        const int line = __LINE__ + 4;
+        auto traverse = [&values] {
+            long sum = 0;
+            for (int i = 0; i < 40; ++i) {
+                for (int value : make_reversible(values)) {
+                    sum += value;
+                }
+            }
+            return sum;
+        };
+        // The tables of the threads that exited are kept, and reused by the next threads
+        for (int round = 0; round < 3; ++round) {
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; ++t) {
+                threads.emplace_back([&traverse] { traverse(); });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+        }
+        traverse();
+        CHECK(samples_at(line) == 13 * 40 / 4);
+    }},
+    {"histograms_and_exports", [] {
+        range_timing::site_stats stats{"file.cpp", 1, 4, 80, {}};
+        stats.m_buckets[3] = 2; // [4, 8) ns
+        stats.m_buckets[5] = 2; // [16, 32) ns
+        CHECK(stats.mean_ns() == 20.0);
+        CHECK(stats.quantile_ns(0.5) == 8 && stats.quantile_ns(0.99) == 32);
+
+        range_timing::reset();
+        const std::vector<int> values{1, 2, 3};
+        const int line = __LINE__ + 2;
+        for (int i = 0; i < 8; ++i) {
+            for (int value : make_reversible(values)) {
+                (void)value;
+            }
+        }
+        std::ostringstream text;
+        range_timing::write_text(text);
+        const std::string site = std::string(__FILE__) + ":" + std::to_string(line);
+        CHECK(text.str().rfind("samples  est. traversals", 0) == 0);
+        CHECK(text.str().find(site + "\n") != std::string::npos);
+        CHECK(text.str().find("      2                8") != std::string::npos); // 2 samples, estimated to 2 * 4 traversals
+
+        std::ostringstream json;
+        range_timing::write_json(json);
+        CHECK(json.str().rfind("{\"samplePeriod\":4,\"sites\":[{\"file\":\"", 0) == 0);
+        CHECK(json.str().find("\"line\":" + std::to_string(line) + ",\"samples\":2,") != std::string::npos);
+        const std::string histogram = json.str().substr(json.str().find("\"histogram\":[") + 13);
+        std::uint64_t count = 0;
+        std::size_t buckets = 0;
+        std::istringstream in(histogram.substr(0, histogram.find(']')));
+        for (std::string bucket; std::getline(in, bucket, ',');) {
+            count += std::stoull(bucket);
+            ++buckets;
+        }
+        CHECK(buckets == range_timing::BucketCount && count == 2);
+        CHECK(json.str().substr(json.str().size() - 5) == "]}]}\n");
+    }},
+};
+
+} // namespace
+
+int main(int argc, char** argv) { return run_functional_tests(argc, argv, Tests); }